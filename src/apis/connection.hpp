@@ -23,10 +23,12 @@
 #ifndef LIBSLIRC_HDR_APIS_CONNECTION_HPP_INCLUDED
 #define LIBSLIRC_HDR_APIS_CONNECTION_HPP_INCLUDED
 
+#include <cstddef>
 #include <string>
 
 #include "../event.hpp"
 #include "../module_api.hpp"
+#include "../helper/shared_buffer.hpp"
 
 namespace slirc {
 namespace apis {
@@ -56,6 +58,18 @@ struct connection: module_api<slirc::apis::connection> {
 		disconnecting ///< Connection is shutting down.
 	};
 
+	/**
+	 * \brief Priority classes for outgoing data.
+	 *
+	 * If outgoing data has to be held back to avoid being disconnected for
+	 * flooding, higher priority data is sent first.
+	 */
+	enum class send_priority {
+		urgent, ///< Keeps the connection alive or registers it, e.g. PONG or NICK.
+		interactive, ///< Default for everything else, e.g. replies to users.
+		bulk ///< Data that may wait, e.g. long listings.
+	};
+
 	/**
 	 * \brief Connect to the IRC server.
 	 */
@@ -80,6 +94,76 @@ struct connection: module_api<slirc::apis::connection> {
 	 */
 	virtual void send(const std::string &data) = 0;
 
+	/**
+	 * \brief Send a shared buffer over the connection.
+	 *
+	 * Allows sending the same data over many connections without copying it
+	 * for each of them.
+	 *
+	 * The default implementation sends a copy of the data. Implementations
+	 * should override it to pass the buffer on without copying.
+	 *
+	 * \param data The data to send. A null buffer is ignored.
+	 */
+	virtual void send(const helper::shared_buffer &data) {
+		if (data) {
+			send(*data);
+		}
+	}
+
+	/**
+	 * \brief Send some data over the connection with an explicit priority.
+	 *
+	 * The default implementation ignores the priority.
+	 *
+	 * \param data The data to send.
+	 * \param priority The priority class of the data.
+	 */
+	virtual void send(const std::string &data, send_priority priority) {
+		static_cast<void>(priority);
+		send(data);
+	}
+
+	/**
+	 * \brief Send a shared buffer over the connection with an explicit
+	 *        priority.
+	 *
+	 * The default implementation ignores the priority.
+	 *
+	 * \param data The data to send.
+	 * \param priority The priority class of the data.
+	 */
+	virtual void send(const helper::shared_buffer &data, send_priority priority) {
+		static_cast<void>(priority);
+		send(data);
+	}
+
+	/**
+	 * \brief Returns the number of lines held back to avoid flooding.
+	 *
+	 * The default implementation does not hold back anything.
+	 *
+	 * \return The number of lines waiting to be sent.
+	 */
+	virtual std::size_t queued_lines() const {
+		return 0;
+	}
+
+	/**
+	 * \brief Returns the number of lines of a priority class held back to
+	 *        avoid flooding.
+	 *
+	 * The default implementation does not hold back anything.
+	 *
+	 * \param priority The priority class to query.
+	 *
+	 * \return The number of lines of that class waiting to be sent.
+	 */
+	virtual std::size_t queued_lines(send_priority priority) const {
+		static_cast<void>(priority);
+		return 0;
+	}
+
 	/**
 	 * \brief Event that is raised when the connection status changes.
 	 *
@@ -97,6 +181,35 @@ struct connection: module_api<slirc::apis::connection> {
 		connection_status new_status; ///< The new connection status.
 	};
 
+	/**
+	 * \brief Event tag describing an automatic reconnect attempt.
+	 *
+	 * Attached to status_change_event in addition to status_change if the
+	 * connection is being reestablished automatically.
+	 */
+	struct reconnect_info {
+		unsigned attempt; ///< The number of the attempt, starting at 1.
+		std::string server; ///< The server being connected to.
+	};
+
+	/**
+	 * \brief Event that is raised when outgoing data piles up or has been
+	 *        drained again.
+	 *
+	 * The details are attached in a send_pressure tag.
+	 */
+	struct send_pressure_event: event::type {};
+
+	/**
+	 * \brief Event tag describing the amount of outgoing data.
+	 *
+	 * Attached to send_pressure_event.
+	 */
+	struct send_pressure {
+		bool congested; ///< Whether the high water mark has been reached (true) or the low water mark (false).
+		std::size_t queued_bytes; ///< The number of bytes waiting to be sent.
+	};
+
 	/**
 	 * \brief Event that is raised when a line is received.
 	 *
@@ -22,23 +22,250 @@
 
 #include "protocol.hpp"
 
+#include <cstdint>
+#include <cstring>
+
+#include "../helper/simd.hpp"
+
+namespace {
+	// The line is split in segments of this many bytes, one bit per byte.
+	const std::size_t segment_words = 64;
+	const std::size_t segment_length = 64 * segment_words;
+
+	// Sets the bits of the spaces in data[0, length) in bits and all bits
+	// past length in the last word. length is at most segment_length.
+	typedef void (*space_mask_function)(const char *data, std::size_t length, std::uint64_t *bits);
+
+#ifndef LIBSLIRC_HAVE_SSE2
+	void pad_mask(std::size_t length, std::uint64_t *bits) {
+		if (length % 64) {
+			bits[length / 64] |= ~std::uint64_t(0) << (length % 64);
+		}
+	}
+
+	void space_mask_scalar(const char *data, std::size_t length, std::uint64_t *bits) {
+		for(std::size_t i=0; i<length; i+=64) {
+			std::uint64_t word = 0;
+			const std::size_t word_length = length - i < 64 ? length - i : 64;
+			for(std::size_t j=0; j<word_length; ++j) {
+				word |= std::uint64_t(data[i+j] == ' ') << j;
+			}
+			bits[i / 64] = word;
+		}
+		pad_mask(length, bits);
+	}
+#endif
+
+#ifdef LIBSLIRC_HAVE_SSE2
+	// Returns the mask of the last length % 64 bytes, with all bits past
+	// length set. Reading past the end might fault, so the last 64 bytes are
+	// read instead if there are that many; a copy padded with spaces
+	// otherwise.
+	template <typename WordFunction>
+	inline std::uint64_t tail_word(const char *data, std::size_t length, WordFunction word) {
+		const unsigned rest = length % 64;
+		if (length >= 64) {
+			return word(data + length - 64) >> (64 - rest) | ~std::uint64_t(0) << rest;
+		}
+		char tail[64];
+		std::memset(tail, ' ', sizeof(tail));
+		std::memcpy(tail, data, length);
+		return word(tail);
+	}
+
+	inline std::uint64_t space_word_sse2(const char *data) {
+		const __m128i space = _mm_set1_epi8(' ');
+		std::uint64_t word = 0;
+		for(unsigned i=0; i<64; i+=16) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+			word |= std::uint64_t(static_cast<std::uint16_t>(
+				_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, space)))) << i;
+		}
+		return word;
+	}
+
+	void space_mask_sse2(const char *data, std::size_t length, std::uint64_t *bits) {
+		std::size_t i = 0;
+		for(; length - i >= 64; i += 64) {
+			bits[i / 64] = space_word_sse2(data + i);
+		}
+		if (i != length) {
+			bits[i / 64] = tail_word(data, length, &space_word_sse2);
+		}
+	}
+#endif
+
+#ifdef LIBSLIRC_HAVE_AVX2_DISPATCH
+	LIBSLIRC_TARGET_AVX2
+	inline std::uint64_t space_word_avx2(const char *data) {
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+		const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 32));
+		return
+			std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, space)))) |
+			std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, space)))) << 32;
+	}
+
+	LIBSLIRC_TARGET_AVX2
+	void space_mask_avx2(const char *data, std::size_t length, std::uint64_t *bits) {
+		std::size_t i = 0;
+		for(; length - i >= 64; i += 64) {
+			bits[i / 64] = space_word_avx2(data + i);
+		}
+		if (i != length) {
+			bits[i / 64] = tail_word(data, length, &space_word_avx2);
+		}
+	}
+#endif
+
+	space_mask_function select_space_mask() {
+#if defined(LIBSLIRC_HAVE_AVX2_DISPATCH)
+		if (slirc::helper::simd::cpu_has_avx2()) {
+			return &space_mask_avx2;
+		}
+		return &space_mask_sse2;
+#elif defined(LIBSLIRC_HAVE_SSE2)
+		return &space_mask_sse2;
+#else
+		return &space_mask_scalar;
+#endif
+	}
+}
+
 std::vector<std::string> slirc::apis::protocol::irc_split(const std::string &line) {
+	parameter_list views;
+	irc_split(line, views);
+
 	std::vector<std::string> params;
+	params.reserve(views.size());
+	for(const boost::string_ref &view: views) {
+		params.emplace_back(view.data(), view.size());
+	}
+	return params;
+}
+
+void slirc::apis::protocol::irc_split(boost::string_ref line, parameter_list &params) {
+	// chosen once, the CPU does not change
+	static const space_mask_function space_mask = select_space_mask();
+
+	params.clear();
+
+	const char *const data = line.data();
+	const std::size_t length = line.size();
+	bool in_parameter = false;
+	std::size_t begin = 0; // of the current parameter
+
+	std::uint64_t bits[segment_words];
+	for(std::size_t segment = 0; segment < length; segment += segment_length) {
+		const std::size_t current_length = length - segment < segment_length ? length - segment : segment_length;
+		space_mask(data + segment, current_length, bits);
+
+		// Walk the boundaries between spaces and parameters, skipping all
+		// bits before the current position.
+		for(std::size_t word = 0; word * 64 < current_length; ++word) {
+			const std::uint64_t spaces = bits[word];
+			const std::size_t offset = segment + word * 64;
+			unsigned position = 0;
+			for(;;) {
+				const std::uint64_t mask = (in_parameter ? spaces : ~spaces) & (~std::uint64_t(0) << position);
+				if (!mask) {
+					break;
+				}
+				position = helper::simd::first_bit(mask);
+				if (in_parameter) {
+					params.emplace_back(data + begin, offset + position - begin);
+					in_parameter = false;
+				}
+				else if (data[offset + position] == ':' && !params.empty()) {
+					// the last parameter takes the rest of the line
+					params.emplace_back(data + offset + position + 1, length - (offset + position + 1));
+					return;
+				}
+				else {
+					begin = offset + position;
+					in_parameter = true;
+				}
+			}
+		}
+	}
+	if (in_parameter) {
+		params.emplace_back(data + begin, length - begin);
+	}
+}
+
+boost::string_ref slirc::apis::protocol::split_message_tags(boost::string_ref line, message_tags &tags) {
+	tags.entries.clear();
+	if (line.empty() || line[0] != '@') {
+		return line;
+	}
+
+	const char *begin = line.data() + 1;
+	const char *const end = line.data() + line.size();
+	const char *block_end = static_cast<const char *>(std::memchr(begin, ' ', end - begin));
+	if (!block_end) {
+		block_end = end;
+	}
 
-	std::string::size_type begin, end=0;
-	while(end != line.npos) {
-		begin = line.find_first_not_of(' ', end);
-		if (begin != line.npos) {
-			if (line[begin]==':' && !params.empty()) {
-				end = line.npos;
-				++begin;
+	while (begin != block_end) {
+		const char *tag_end = static_cast<const char *>(std::memchr(begin, ';', block_end - begin));
+		if (!tag_end) {
+			tag_end = block_end;
+		}
+		if (tag_end != begin) {
+			const char *equals = static_cast<const char *>(std::memchr(begin, '=', tag_end - begin));
+			message_tags::entry tag;
+			if (equals) {
+				tag.key = boost::string_ref(begin, equals - begin);
+				tag.raw_value = boost::string_ref(equals + 1, tag_end - equals - 1);
 			}
 			else {
-				end = line.find_first_of(' ', begin);
+				tag.key = boost::string_ref(begin, tag_end - begin);
 			}
-			params.emplace_back(line.substr(begin, end-begin));
+			tags.entries.push_back(tag);
 		}
+		begin = tag_end == block_end ? tag_end : tag_end + 1;
 	}
 
-	return params;
+	return boost::string_ref(block_end, end - block_end);
+}
+
+bool slirc::apis::protocol::message_tags::has(boost::string_ref key) const {
+	for(const entry &tag: entries) {
+		if (tag.key == key) {
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string slirc::apis::protocol::message_tags::value(boost::string_ref key) const {
+	// the last one counts
+	for(auto it = entries.rbegin(); it != entries.rend(); ++it) {
+		if (it->key == key) {
+			return unescape(it->raw_value);
+		}
+	}
+	return std::string();
+}
+
+std::string slirc::apis::protocol::message_tags::unescape(boost::string_ref raw_value) {
+	std::string value;
+	value.reserve(raw_value.size());
+	for(std::size_t i=0; i<raw_value.size(); ++i) {
+		if (raw_value[i] != '\\') {
+			value += raw_value[i];
+			continue;
+		}
+		if (++i == raw_value.size()) {
+			break; // a trailing backslash is dropped
+		}
+		switch (raw_value[i]) {
+		case ':': value += ';'; break;
+		case 's': value += ' '; break;
+		case 'r': value += '\r'; break;
+		case 'n': value += '\n'; break;
+		default: value += raw_value[i]; break; // including '\\'
+		}
+	}
+	return value;
 }
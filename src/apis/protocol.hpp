@@ -23,9 +23,13 @@
 #ifndef LIBSLIRC_HDR_APIS_PROTOCOL_HPP_INCLUDED
 #define LIBSLIRC_HDR_APIS_PROTOCOL_HPP_INCLUDED
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
+#include <boost/container/small_vector.hpp>
+#include <boost/utility/string_ref.hpp>
+
 #include "../event.hpp"
 #include "../module_api.hpp"
 
@@ -38,8 +42,22 @@ namespace apis {
 struct protocol: module_api<slirc::apis::protocol> {
 	using module_api::module_api;
 
+	/**
+	 * \brief A list of parameters referring to the line they were split from.
+	 *
+	 * Up to 17 parameters (a prefix, a command and 15 parameters, the most
+	 * RFC 1459 allows) are stored without allocating.
+	 */
+	typedef boost::container::small_vector<boost::string_ref, 17> parameter_list;
+
 ///////////////////////////////////////////////////////////////////////////////
 // Defined tags
+//
+// The string_refs in the parameters and message_tags tags refer to the
+// raw_irc_line tag of the same event (see apis::connection::raw_irc_line).
+// They are valid as long as that tag is neither replaced nor removed; copy
+// them to std::strings to keep them any longer. All other tags own their
+// strings.
 
 	/**
 	 * \brief Event tag specifying CTCPs types.
@@ -62,6 +80,22 @@ struct protocol: module_api<slirc::apis::protocol> {
 		std::string new_nick;
 	};
 
+	/**
+	 * \brief Event tag specifying the channel a user is invited to.
+	 */
+	struct invitation {
+		/// The name of the channel.
+		std::string channel;
+	};
+
+	/**
+	 * \brief Event tag specifying the user being kicked.
+	 */
+	struct kick_target {
+		/// The nickname of the kicked user.
+		std::string nick;
+	};
+
 	/**
 	 * \brief Event tag containing the text message.
 	 */
@@ -80,6 +114,60 @@ struct protocol: module_api<slirc::apis::protocol> {
 		} type;
 	};
 
+	/**
+	 * \brief Event tag containing the IRCv3 message tags of a line.
+	 *
+	 * Only attached to lines starting with a tag block ("@key=value;...").
+	 * The tags are split when the line is parsed, but their values are only
+	 * unescaped by value().
+	 */
+	struct message_tags {
+		/**
+		 * \brief A single tag.
+		 */
+		struct entry {
+			/// The key, including a client prefix ('+') and vendor, if any.
+			boost::string_ref key;
+			/// The value as sent, still escaped. Empty if there is none.
+			boost::string_ref raw_value;
+		};
+
+		/// The tags in the order they were sent.
+		boost::container::small_vector<entry, 8> entries;
+
+		/**
+		 * \brief Checks whether a tag is present.
+		 */
+		bool has(boost::string_ref key) const;
+
+		/**
+		 * \brief Returns the unescaped value of a tag.
+		 *
+		 * \param key The key of the tag. If it was sent more than once, the
+		 *            last value counts.
+		 *
+		 * \return The value, or an empty string if the tag has no value or is
+		 *         not present at all.
+		 */
+		std::string value(boost::string_ref key) const;
+
+		/**
+		 * \brief Unescapes a tag value according to IRCv3.
+		 */
+		static std::string unescape(boost::string_ref raw_value);
+	};
+
+	/**
+	 * \brief Event tag specifying a mode change.
+	 */
+	struct mode_change {
+		/// The modes being set and unset, e.g. "+o-v".
+		std::string modes;
+		/// The index of the first mode argument in the \ref parameters tag.
+		/// Equals the number of parameters if there are no arguments.
+		std::size_t first_argument;
+	};
+
 	/**
 	 * \brief Event tag specifying a nick change.
 	 */
@@ -118,7 +206,7 @@ struct protocol: module_api<slirc::apis::protocol> {
 	 */
 	struct parameters {
 		/// The parameters extracted from the message according to the protocol.
-		std::vector<std::string> params;
+		parameter_list params;
 	};
 
 	/**
@@ -151,10 +239,52 @@ struct protocol: module_api<slirc::apis::protocol> {
 	struct parsed_event: event::requires_tags<parameters> {};
 
 //	struct ctcp_event: event::requires_tags<parameters, origin> {};
-//	struct error_event: event::requires_tags<parameters> {};
-//	struct invite_event: event::requires_tags<parameters, origin> {};
-//	struct join_event: event::requires_tags<parameters, origin> {};
-//	struct kick_event: event::requires_tags<parameters, origin> {};
+
+	/**
+	 * \brief Event that is raised when the server reports an error, usually
+	 *        right before closing the connection.
+	 *
+	 * - Always has a \ref parameters tag attached containing the split
+	 *   parameters.
+	 * - Always has a \ref message tag attached containing the error message.
+	 */
+	struct error_event: event::requires_tags<parameters, message> {};
+
+	/**
+	 * \brief Event that is raised when a user is invited to a channel.
+	 *
+	 * - Always has a \ref parameters tag attached containing the split
+	 *   parameters.
+	 * - Always has an \ref origin tag attached denoting the inviting user.
+	 * - Always has a \ref recipient tag attached specifying the invited user.
+	 * - Always has an \ref invitation tag attached specifying the channel.
+	 */
+	struct invite_event: event::requires_tags<parameters, origin, recipient, invitation> {};
+
+	/**
+	 * \brief Event that is raised when a user joins a channel.
+	 *
+	 * - Always has a \ref parameters tag attached containing the split
+	 *   parameters.
+	 * - Always has an \ref origin tag attached denoting the joining user.
+	 * - Always has a \ref recipient tag attached specifying the channel that
+	 *   is being joined.
+	 */
+	struct join_event: event::requires_tags<parameters, origin, recipient> {};
+
+	/**
+	 * \brief Event that is raised when a user is kicked from a channel.
+	 *
+	 * - Always has a \ref parameters tag attached containing the split
+	 *   parameters.
+	 * - Always has an \ref origin tag attached denoting the kicking user.
+	 * - Always has a \ref recipient tag attached specifying the channel.
+	 * - Always has a \ref kick_target tag attached specifying the kicked
+	 *   user.
+	 * - Has a \ref message tag attached containing the reason iff a reason
+	 *   was given.
+	 */
+	struct kick_event: event::requires_tags<parameters, origin, recipient, kick_target> {};
 
 	/**
 	 * \brief Event that is raised when a user changes his nickname
@@ -168,7 +298,18 @@ struct protocol: module_api<slirc::apis::protocol> {
 	 *   of message (privmsg vs notice).
 	 */
 	struct message_event: event::requires_tags<parameters, origin, recipient, message> {};
-//	struct mode_event: event::requires_tags<parameters, origin> {};
+
+	/**
+	 * \brief Event that is raised when the modes of a channel or user change.
+	 *
+	 * - Always has a \ref parameters tag attached containing the split
+	 *   parameters.
+	 * - Always has an \ref origin tag attached denoting the sender.
+	 * - Always has a \ref recipient tag attached specifying the channel or
+	 *   user whose modes change.
+	 * - Always has a \ref mode_change tag attached specifying the modes.
+	 */
+	struct mode_event: event::requires_tags<parameters, origin, recipient, mode_change> {};
 
 	/**
 	 * \brief Event that is raised when a user changes his nickname
@@ -197,6 +338,25 @@ struct protocol: module_api<slirc::apis::protocol> {
 	 */
 	struct numeric_event: event::requires_tags<parameters, origin, numeric> {};
 
+	/**
+	 * \brief Event that is raised when a particular numeric is received.
+	 *
+	 * Raised in addition to numeric_event, after it, so handlers can
+	 * subscribe to just the numerics they care about, e.g.
+	 * numeric_event_t<433> for ERR_NICKNAMEINUSE.
+	 *
+	 * - Always has a \ref parameters tag attached containing the split
+	 *   parameters.
+	 * - Always has an \ref origin tag attached denoting the sender.
+	 * - Always has a \ref numeric tag attached specifying the numerics number.
+	 *
+	 * \tparam Number The number of the numeric, less than 1000.
+	 */
+	template <unsigned Number>
+	struct numeric_event_t: event::requires_tags<parameters, origin, numeric> {
+		static_assert(Number < 1000, "Numerics have three digits.");
+	};
+
 	/**
 	 * \brief Event that is raised when a user parts a channel.
 	 *
@@ -232,8 +392,27 @@ struct protocol: module_api<slirc::apis::protocol> {
 	 */
 	struct quit_event: event::requires_tags<parameters, origin> {};
 
-//	struct topic_event: event::requires_tags<parameters, origin> {};
-//	struct wallops_event: event::requires_tags<parameters, origin> {};
+	/**
+	 * \brief Event that is raised when the topic of a channel changes.
+	 *
+	 * - Always has a \ref parameters tag attached containing the split
+	 *   parameters.
+	 * - Always has an \ref origin tag attached denoting the sender.
+	 * - Always has a \ref recipient tag attached specifying the channel.
+	 * - Always has a \ref message tag attached containing the new topic,
+	 *   which is empty if the topic has been removed.
+	 */
+	struct topic_event: event::requires_tags<parameters, origin, recipient, message> {};
+
+	/**
+	 * \brief Event that is raised when receiving a WALLOPS message.
+	 *
+	 * - Always has a \ref parameters tag attached containing the split
+	 *   parameters.
+	 * - Always has an \ref origin tag attached denoting the sender.
+	 * - Always has a \ref message tag attached containing the message.
+	 */
+	struct wallops_event: event::requires_tags<parameters, origin, message> {};
 
 
 
@@ -252,6 +431,30 @@ struct protocol: module_api<slirc::apis::protocol> {
 	 * \return A vector of the single parameters.
 	 */
 	static std::vector<std::string> irc_split(const std::string &raw);
+
+	/**
+	 * \brief Extracts the parameters from an IRC line without copying them.
+	 *
+	 * Splits like irc_split(const std::string &), but the parameters refer
+	 * to the line instead of being copied.
+	 *
+	 * \param raw The raw IRC line, end of line characters removed.
+	 * \param params Receives the single parameters. Previous contents are
+	 *               removed.
+	 */
+	static void irc_split(boost::string_ref raw, parameter_list &params);
+
+	/**
+	 * \brief Splits the IRCv3 tag block off an IRC line.
+	 *
+	 * \param raw The raw IRC line, end of line characters removed.
+	 * \param tags Receives the tags, referring to the line. Previous
+	 *             contents are removed.
+	 *
+	 * \return The rest of the line, to be passed to irc_split(). The whole
+	 *         line if it does not start with a tag block.
+	 */
+	static boost::string_ref split_message_tags(boost::string_ref raw, message_tags &tags);
 };
 
 }
@@ -231,10 +231,10 @@ template<typename FirstTag, typename ...DataTags>
 struct check_event_tags<FirstTag, DataTags...> {
 	check_event_tags() = delete;
 
-	inline bool check(const event &e) {
+	inline static bool check(const event &e) {
 		return
 			nullptr != e.data.get_p<FirstTag>() &&
-			check_event_tags<DataTags...>::check();
+			check_event_tags<DataTags...>::check(e);
 	}
 };
 template<>
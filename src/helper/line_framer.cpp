@@ -0,0 +1,90 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#include "line_framer.hpp"
+
+#include "simd.hpp"
+
+namespace {
+	typedef const char *(*find_function)(const char *, const char *);
+
+	const char *find_scalar(const char *begin, const char *end) {
+		for(; begin != end; ++begin) {
+			if (*begin == '\r' || *begin == '\n') {
+				break;
+			}
+		}
+		return begin;
+	}
+
+#ifdef LIBSLIRC_HAVE_SSE2
+	const char *find_sse2(const char *begin, const char *end) {
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i lf = _mm_set1_epi8('\n');
+		for(; end - begin >= 16; begin += 16) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+			const std::uint32_t mask = _mm_movemask_epi8(_mm_or_si128(
+				_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, lf)));
+			if (mask) {
+				return begin + slirc::helper::simd::first_bit(mask);
+			}
+		}
+		return find_scalar(begin, end);
+	}
+#endif
+
+#ifdef LIBSLIRC_HAVE_AVX2_DISPATCH
+	LIBSLIRC_TARGET_AVX2
+	const char *find_avx2(const char *begin, const char *end) {
+		const __m256i cr = _mm256_set1_epi8('\r');
+		const __m256i lf = _mm256_set1_epi8('\n');
+		for(; end - begin >= 32; begin += 32) {
+			const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+			const std::uint32_t mask = _mm256_movemask_epi8(_mm256_or_si256(
+				_mm256_cmpeq_epi8(chunk, cr), _mm256_cmpeq_epi8(chunk, lf)));
+			if (mask) {
+				return begin + slirc::helper::simd::first_bit(mask);
+			}
+		}
+		return find_sse2(begin, end);
+	}
+#endif
+
+	find_function select_find() {
+#if defined(LIBSLIRC_HAVE_AVX2_DISPATCH)
+		if (slirc::helper::simd::cpu_has_avx2()) {
+			return &find_avx2;
+		}
+		return &find_sse2;
+#elif defined(LIBSLIRC_HAVE_SSE2)
+		return &find_sse2;
+#else
+		return &find_scalar;
+#endif
+	}
+}
+
+const char *slirc::helper::find_line_ending(const char *begin, const char *end) {
+	// chosen once, the CPU does not change
+	static const find_function find_implementation = select_find();
+	return find_implementation(begin, end);
+}
@@ -0,0 +1,176 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_HELPER_LINE_FRAMER_HPP_INCLUDED
+#define LIBSLIRC_HDR_HELPER_LINE_FRAMER_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstring>
+
+#include "linear_buffer.hpp"
+
+namespace slirc {
+namespace helper {
+
+/**
+ * \brief Finds the first line ending ('\r' or '\n') in a range.
+ *
+ * Scans 32 bytes at a time with AVX2 if the CPU supports it, 16 bytes at a
+ * time with SSE2 otherwise, and one byte at a time on other platforms.
+ *
+ * \return A pointer to the line ending, or end if there is none.
+ */
+const char *find_line_ending(const char *begin, const char *end);
+
+/**
+ * \brief Splits a stream of bytes into lines.
+ *
+ * Lines may end with "\r\n", "\r" or "\n"; "\r\n" counts as a single line
+ * ending. Empty lines are skipped.
+ *
+ * Lines longer than the maximum line length are dropped as a whole, even if
+ * they arrive in pieces, so a peer never sending a line ending cannot make
+ * the receiver buffer an unlimited amount of data.
+ *
+ * \note This type is not thread safe.
+ */
+struct line_framer {
+	/**
+	 * \brief The default maximum line length: 8191 bytes of IRCv3 message
+	 *        tags plus 512 bytes of message.
+	 */
+	static const std::size_t default_max_line_length = 8703;
+
+	/**
+	 * \brief Constructs a line framer.
+	 *
+	 * \param max_line_length The length of the longest line to accept, not
+	 *                        counting the line ending.
+	 */
+	explicit line_framer(std::size_t max_line_length = default_max_line_length)
+	: max_length(max_line_length)
+	, discarding(false)
+	, discarded(0)
+	{}
+
+	/**
+	 * \brief Splits data into lines in place.
+	 *
+	 * \param data A pointer to the data.
+	 * \param length The number of bytes available at data.
+	 * \param handler Called as handler(const char *line, std::size_t length)
+	 *                for every complete line, without its line ending. The
+	 *                line points into data.
+	 *
+	 * \return The number of bytes consumed. The remaining data is an
+	 *         incomplete line and has to be passed again, followed by more
+	 *         data. It is never longer than the maximum line length.
+	 */
+	template <typename Handler>
+	std::size_t frame(const char *data, std::size_t length, Handler &&handler) {
+		const char *const end = data + length;
+		const char *begin = data;
+		const char *eol;
+		while (end != (eol = find_line_ending(begin, end))) {
+			if (discarding) {
+				// the rest of a line that has already been dropped
+				discarding = false;
+			}
+			else if (static_cast<std::size_t>(eol - begin) > max_length) {
+				++discarded;
+			}
+			else if (eol != begin) {
+				handler(static_cast<const char *>(begin), static_cast<std::size_t>(eol - begin));
+			}
+
+			begin = eol + 1;
+			// A '\n' arriving with the next data makes an empty line, which
+			// is skipped just as well.
+			if (*eol == '\r' && begin != end && *begin == '\n') {
+				++begin;
+			}
+		}
+
+		if (discarding || static_cast<std::size_t>(end - begin) > max_length) {
+			// drop the data right away instead of waiting for the line ending
+			discarded += !discarding;
+			discarding = true;
+			return length;
+		}
+		return begin - data;
+	}
+
+	/**
+	 * \brief Splits data into lines, keeping incomplete lines until the rest
+	 *        arrives with the next call.
+	 *
+	 * \param data A pointer to the data.
+	 * \param length The number of bytes available at data.
+	 * \param handler Called like for frame(). The line is only valid during
+	 *                the call.
+	 */
+	template <typename Handler>
+	void feed(const char *data, std::size_t length, Handler &&handler) {
+		if (buffer.empty()) {
+			// the common case: no copying at all unless a line is incomplete
+			const std::size_t consumed = frame(data, length, handler);
+			data += consumed;
+			length -= consumed;
+		}
+		else {
+			std::memcpy(buffer.prepare(length), data, length);
+			buffer.commit(length);
+			buffer.consume(frame(buffer.data(), buffer.size(), handler));
+			return;
+		}
+		if (length) {
+			std::memcpy(buffer.prepare(length), data, length);
+			buffer.commit(length);
+		}
+	}
+
+	/**
+	 * \brief Forgets all incomplete lines, e.g. when a new stream starts.
+	 */
+	void reset() {
+		discarding = false;
+		buffer.consume(buffer.size());
+	}
+
+	/**
+	 * \brief Returns the number of lines dropped for being too long.
+	 */
+	std::size_t discarded_lines() const {
+		return discarded;
+	}
+
+private:
+	std::size_t max_length;
+	bool discarding; // dropping everything up to the next line ending
+	std::size_t discarded;
+	linear_buffer buffer; // incomplete line kept by feed()
+};
+
+}
+}
+
+#endif // LIBSLIRC_HDR_HELPER_LINE_FRAMER_HPP_INCLUDED
@@ -0,0 +1,58 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#include "linear_buffer.hpp"
+
+#include <algorithm>
+
+slirc::helper::linear_buffer::linear_buffer(std::size_t initial_capacity)
+: storage(initial_capacity)
+, read_pos(0)
+, write_pos(0) {}
+
+char *slirc::helper::linear_buffer::prepare(std::size_t length) {
+	if (storage.size() - write_pos < length) {
+		// Not enough room behind the data. Move the data to the front first,
+		// and only grow if that still does not suffice.
+		if (read_pos) {
+			std::copy(storage.begin() + read_pos, storage.begin() + write_pos,
+				storage.begin());
+			write_pos -= read_pos;
+			read_pos = 0;
+		}
+		if (storage.size() - write_pos < length) {
+			storage.resize(std::max(write_pos + length, 2 * storage.size()));
+		}
+	}
+	return storage.data() + write_pos;
+}
+
+void slirc::helper::linear_buffer::shrink(std::size_t min_capacity) {
+	min_capacity = std::max(min_capacity, size());
+	if (min_capacity < storage.size()) {
+		std::vector<char> shrunk(storage.begin() + read_pos, storage.begin() + write_pos);
+		shrunk.resize(min_capacity);
+		storage.swap(shrunk);
+		write_pos -= read_pos;
+		read_pos = 0;
+	}
+}
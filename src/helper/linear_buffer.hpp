@@ -0,0 +1,140 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_HELPER_LINEAR_BUFFER_HPP_INCLUDED
+#define LIBSLIRC_HDR_HELPER_LINEAR_BUFFER_HPP_INCLUDED
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace slirc {
+namespace helper {
+
+/**
+ * \brief A reusable, contiguous byte buffer with separate read and write
+ *        cursors.
+ *
+ * Data is written to the area returned by prepare() and made readable by
+ * commit(). Readable data can be inspected in place and released by consume().
+ *
+ * Consuming data only advances the read cursor. Unread data is moved to the
+ * front of the buffer lazily, when more room is needed for writing, so the
+ * readable data is always presented as a single contiguous block.
+ *
+ * \note This type is not thread safe.
+ */
+struct linear_buffer {
+	/**
+	 * \brief Constructs an empty buffer.
+	 *
+	 * \param initial_capacity The number of bytes to allocate up front.
+	 */
+	explicit linear_buffer(std::size_t initial_capacity = 0);
+
+	/**
+	 * \brief Returns a pointer to the readable data.
+	 *
+	 * \note The pointer is invalidated by calls to prepare().
+	 */
+	inline const char *data() const {
+		return storage.data() + read_pos;
+	}
+
+	/**
+	 * \brief Returns the number of readable bytes.
+	 */
+	inline std::size_t size() const {
+		return write_pos - read_pos;
+	}
+
+	/**
+	 * \brief Checks whether there is any readable data.
+	 */
+	inline bool empty() const {
+		return write_pos == read_pos;
+	}
+
+	/**
+	 * \brief Returns the number of bytes currently allocated.
+	 */
+	inline std::size_t capacity() const {
+		return storage.size();
+	}
+
+	/**
+	 * \brief Releases data from the front of the readable data.
+	 *
+	 * \param length The number of bytes to release. Must not be larger than
+	 *               size().
+	 */
+	inline void consume(std::size_t length) {
+		assert(length <= size() && "Cannot consume more than is readable.");
+		read_pos += length;
+		if (read_pos == write_pos) {
+			// everything has been read - start over at the front for free
+			read_pos = write_pos = 0;
+		}
+	}
+
+	/**
+	 * \brief Provides room for writing more data.
+	 *
+	 * \param length The number of bytes to be writable at least.
+	 *
+	 * \return A pointer to at least length writable bytes.
+	 *
+	 * \note Invalidates pointers previously returned by data() and prepare().
+	 */
+	char *prepare(std::size_t length);
+
+	/**
+	 * \brief Makes written data readable.
+	 *
+	 * \param length The number of bytes written to the area returned by the
+	 *               last call to prepare().
+	 */
+	inline void commit(std::size_t length) {
+		assert(write_pos + length <= storage.size() &&
+			"Cannot commit more than has been prepared.");
+		write_pos += length;
+	}
+
+	/**
+	 * \brief Releases memory not needed for the readable data.
+	 *
+	 * \param min_capacity The number of bytes to keep allocated at least.
+	 *
+	 * \note Invalidates pointers previously returned by data() and prepare().
+	 */
+	void shrink(std::size_t min_capacity);
+
+private:
+	std::vector<char> storage;
+	std::size_t read_pos;
+	std::size_t write_pos;
+};
+
+}
+}
+
+#endif // LIBSLIRC_HDR_HELPER_LINEAR_BUFFER_HPP_INCLUDED
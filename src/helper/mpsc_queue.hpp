@@ -0,0 +1,151 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_HELPER_MPSC_QUEUE_HPP_INCLUDED
+#define LIBSLIRC_HDR_HELPER_MPSC_QUEUE_HPP_INCLUDED
+
+#include <atomic>
+#include <utility>
+
+#include <boost/noncopyable.hpp>
+
+namespace slirc {
+namespace helper {
+
+/**
+ * \brief An unbounded queue for many producers and a single consumer.
+ *
+ * push() is wait-free: it consists of a single atomic exchange and a store,
+ * so producers never block each other or the consumer. pop() is lock-free
+ * and must only ever be called by one thread at a time.
+ *
+ * A push() that has not finished yet may be invisible to pop() while empty()
+ * already reports the queue as non-empty. Consumers that find the queue
+ * non-empty but cannot pop anything should simply retry later.
+ *
+ * Based on Dmitry Vyukov's intrusive MPSC node-based queue.
+ */
+template <typename T>
+struct mpsc_queue: private boost::noncopyable {
+	/**
+	 * \brief Constructs an empty queue.
+	 */
+	mpsc_queue()
+	: head(&stub)
+	, tail(&stub)
+	{}
+
+	/**
+	 * \brief Destructs the queue and all elements left in it.
+	 */
+	~mpsc_queue() {
+		T ignored;
+		while (pop(ignored)) {}
+	}
+
+	/**
+	 * \brief Appends an element. May be called from any thread.
+	 *
+	 * \param value The element to append.
+	 */
+	void push(T value) {
+		push_node(new node(std::move(value)));
+	}
+
+	/**
+	 * \brief Removes the first element. Must only be called by the consumer.
+	 *
+	 * \param value Receives the removed element.
+	 *
+	 * \return true if an element has been removed, false if the queue is
+	 *         (or appears to be) empty.
+	 */
+	bool pop(T &value) {
+		node *first = tail;
+		node *next = first->next.load(std::memory_order_acquire);
+		if (first == &stub) {
+			if (!next) {
+				return false;
+			}
+			// skip the stub
+			tail = first = next;
+			next = next->next.load(std::memory_order_acquire);
+		}
+
+		if (!next) {
+			if (first != head.load(std::memory_order_acquire)) {
+				return false; // a producer has not linked its node yet
+			}
+			// first is the last node; put the stub behind it, so first can
+			// be unlinked
+			push_node(&stub);
+			next = first->next.load(std::memory_order_acquire);
+			if (!next) {
+				return false; // another producer got in between
+			}
+		}
+
+		tail = next;
+		value = std::move(first->value);
+		delete first;
+		return true;
+	}
+
+	/**
+	 * \brief Checks whether the queue is empty. Must only be called by the
+	 *        consumer.
+	 */
+	bool empty() const {
+		// Unless it is the stub, the node at the tail still holds an element.
+		return tail == &stub && head.load(std::memory_order_acquire) == &stub;
+	}
+
+private:
+	struct node {
+		node()
+		: next(nullptr)
+		{}
+
+		explicit node(T &&value)
+		: next(nullptr)
+		, value(std::move(value))
+		{}
+
+		std::atomic<node *> next;
+		T value;
+	};
+
+	void push_node(node *n) {
+		n->next.store(nullptr, std::memory_order_relaxed);
+		node *previous = head.exchange(n, std::memory_order_acq_rel);
+		previous->next.store(n, std::memory_order_release);
+	}
+
+	std::atomic<node *> head; // last node, producers append here
+	node *tail; // first node, owned by the consumer
+	node stub;
+};
+
+}
+}
+
+#endif // LIBSLIRC_HDR_HELPER_MPSC_QUEUE_HPP_INCLUDED
@@ -0,0 +1,144 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_HELPER_PINNED_POINTER_HPP_INCLUDED
+#define LIBSLIRC_HDR_HELPER_PINNED_POINTER_HPP_INCLUDED
+
+#include <atomic>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace slirc {
+namespace helper {
+
+/**
+ * \brief A pointer readers can use without locking while a writer replaces
+ *        it.
+ *
+ * Readers pin the pointer for the lifetime of a pin object. Pinning costs
+ * two atomic increments and a few loads; it only has to be retried while
+ * the pointer is being replaced. reset() replaces the pointer and waits
+ * until no reader can still use the previous one, so the caller may destroy
+ * the object it pointed to afterwards.
+ *
+ * Readers are counted in two generations and reset() only waits for the
+ * previous one, so a steady stream of readers cannot keep it waiting.
+ *
+ * The object pointed to is not owned.
+ */
+template <typename T>
+struct pinned_pointer: private boost::noncopyable {
+	/**
+	 * \brief Constructs a null pointer.
+	 */
+	pinned_pointer()
+	: pointer(nullptr)
+	, generation(0)
+	{
+		readers[0] = 0;
+		readers[1] = 0;
+	}
+
+	/**
+	 * \brief Keeps the object pointed to alive while it is used.
+	 */
+	struct pin: private boost::noncopyable {
+		/**
+		 * \brief Pins the current pointer of owner.
+		 */
+		explicit pin(pinned_pointer &owner)
+		: counter(nullptr)
+		, target(nullptr)
+		{
+			for(;;) {
+				const unsigned current = owner.generation.load();
+				counter = &owner.readers[current & 1];
+				++*counter;
+				if (owner.generation.load() == current) {
+					// any reset() from now on waits for this reader
+					break;
+				}
+				--*counter;
+			}
+			target = owner.pointer.load();
+		}
+
+		/**
+		 * \brief Releases the pointer.
+		 */
+		~pin() {
+			--*counter;
+		}
+
+		/**
+		 * \brief Returns the pinned pointer, which may be null.
+		 */
+		T *get() const {
+			return target;
+		}
+
+		/**
+		 * \brief Accesses the object pointed to.
+		 */
+		T *operator->() const {
+			return target;
+		}
+
+		/**
+		 * \brief Checks whether the pinned pointer is not null.
+		 */
+		explicit operator bool() const {
+			return target != nullptr;
+		}
+
+	private:
+		std::atomic<unsigned> *counter;
+		T *target;
+	};
+
+	/**
+	 * \brief Replaces the pointer.
+	 *
+	 * Returns once no reader uses the previous pointer anymore. Must neither
+	 * be called concurrently nor by a thread holding a pin of this pointer.
+	 *
+	 * \param replacement The new pointer, which may be null.
+	 */
+	void reset(T *replacement) {
+		pointer.store(replacement);
+		const unsigned previous = generation.fetch_add(1);
+		while (readers[previous & 1].load()) {
+			boost::this_thread::yield();
+		}
+	}
+
+private:
+	std::atomic<T *> pointer;
+	std::atomic<unsigned> generation;
+	std::atomic<unsigned> readers[2];
+};
+
+}
+}
+
+#endif // LIBSLIRC_HDR_HELPER_PINNED_POINTER_HPP_INCLUDED
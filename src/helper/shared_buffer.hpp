@@ -0,0 +1,57 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_HELPER_SHARED_BUFFER_HPP_INCLUDED
+#define LIBSLIRC_HDR_HELPER_SHARED_BUFFER_HPP_INCLUDED
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace slirc {
+namespace helper {
+
+/**
+ * \brief A refcounted, immutable buffer.
+ *
+ * Shared buffers can be passed to any number of connections at the same time
+ * without copying their contents; the data is released when the last
+ * connection has finished sending it.
+ */
+typedef std::shared_ptr<const std::string> shared_buffer;
+
+/**
+ * \brief Creates a shared buffer.
+ *
+ * \param data The contents of the new buffer. Pass an rvalue to avoid
+ *             copying the data.
+ *
+ * \return The newly created shared buffer.
+ */
+inline shared_buffer make_shared_buffer(std::string data) {
+	return std::make_shared<const std::string>(std::move(data));
+}
+
+}
+}
+
+#endif // LIBSLIRC_HDR_HELPER_SHARED_BUFFER_HPP_INCLUDED
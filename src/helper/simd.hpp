@@ -0,0 +1,97 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+// Internal header: vector instruction support shared by the scanners
+
+#ifndef LIBSLIRC_HDR_HELPER_SIMD_HPP_INCLUDED
+#define LIBSLIRC_HDR_HELPER_SIMD_HPP_INCLUDED
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+
+// SSE2 is part of every x86-64 CPU, so it is used unconditionally.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define LIBSLIRC_HAVE_SSE2
+#	include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled for single functions (marked LIBSLIRC_TARGET_AVX2)
+// and only called after checking the CPU with cpu_has_avx2().
+#if defined(LIBSLIRC_HAVE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#	define LIBSLIRC_HAVE_AVX2_DISPATCH
+#	define LIBSLIRC_TARGET_AVX2 __attribute__((target("avx2")))
+#	include <immintrin.h>
+#endif
+
+namespace slirc {
+namespace helper {
+namespace simd {
+
+/**
+ * \brief Returns the index of the lowest set bit. mask must not be 0.
+ */
+inline unsigned first_bit(std::uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	unsigned index = 0;
+	for(; !(mask & 1); mask >>= 1) {
+		++index;
+	}
+	return index;
+#endif
+}
+
+/**
+ * \brief Returns the index of the lowest set bit. mask must not be 0.
+ */
+inline unsigned first_bit(std::uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(mask);
+#else
+	const std::uint32_t low = static_cast<std::uint32_t>(mask);
+	return low ? first_bit(low) : 32 + first_bit(static_cast<std::uint32_t>(mask >> 32));
+#endif
+}
+
+#ifdef LIBSLIRC_HAVE_AVX2_DISPATCH
+/**
+ * \brief Checks whether the CPU supports AVX2.
+ */
+inline bool cpu_has_avx2() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+}
+}
+}
+
+#endif // LIBSLIRC_HDR_HELPER_SIMD_HPP_INCLUDED
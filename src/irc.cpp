@@ -25,7 +25,10 @@
 #include "irc.hpp"
 
 slirc::irc::irc()
-: event_available(event_available_internal) {
+: event_queue_high_water(0)
+, event_queue_low_water(0)
+, event_queue_above_high_water(false)
+, event_available(event_available_internal) {
 	// The queue starts out empty.
 	event_available_internal.close();
 }
@@ -33,10 +36,10 @@ slirc::irc::irc()
 void slirc::irc::queue_event(event::pointer newevent) {
 	if (newevent) {
 		boost::mutex::scoped_lock lock(event_queue_mutex);
-		std::weak_ptr<event> weakevent(newevent);
-		newevent->handle = [&,weakevent](){ handle(weakevent.lock()); };
+		bind_handle(newevent);
 		event_queue.push_back(newevent);
 		event_available_internal.open();
+		check_high_water(lock);
 	}
 }
 
@@ -47,6 +50,7 @@ void slirc::irc::queue_event_front(event::pointer newevent) {
 		newevent->handle = [&,weakevent](){ handle(weakevent.lock()); };
 		event_queue.push_front(newevent);
 		event_available_internal.open();
+		check_high_water(lock);
 	}
 }
 
@@ -61,9 +65,73 @@ slirc::event::pointer slirc::irc::fetch_event() {
 	if (event_queue.empty()) {
 		event_available_internal.close();
 	}
+	check_low_water(lock);
 	return next;
 }
 
+std::size_t slirc::irc::event_queue_size() {
+	boost::mutex::scoped_lock lock(event_queue_mutex);
+	return event_queue.size();
+}
+
+void slirc::irc::set_event_queue_watermarks(std::size_t high_water, std::size_t low_water) {
+	assert(!high_water || low_water < high_water);
+	boost::mutex::scoped_lock lock(event_queue_mutex);
+	event_queue_high_water = high_water;
+	event_queue_low_water = low_water;
+	if (!high_water) {
+		// no limit at all, so the queue cannot be full
+		event_queue_low_water = event_queue.size();
+	}
+	check_high_water(lock) || check_low_water(lock);
+}
+
+bool slirc::irc::event_queue_full() {
+	boost::mutex::scoped_lock lock(event_queue_mutex);
+	return event_queue_above_high_water;
+}
+
+boost::signals2::connection slirc::irc::on_event_queue_full(std::function<void()> handler) {
+	return event_queue_full_signal.connect(handler);
+}
+
+boost::signals2::connection slirc::irc::on_event_queue_drained(std::function<void()> handler) {
+	return event_queue_drained_signal.connect(handler);
+}
+
+void slirc::irc::bind_handle(const event::pointer &newevent) {
+	std::weak_ptr<event> weakevent(newevent);
+	newevent->handle = [&,weakevent](){ handle(weakevent.lock()); };
+}
+
+bool slirc::irc::check_high_water(boost::mutex::scoped_lock &event_queue_lock) {
+	if (
+		event_queue_high_water &&
+		!event_queue_above_high_water &&
+		event_queue.size() >= event_queue_high_water
+	) {
+		event_queue_above_high_water = true;
+		// The handlers may well queue events themselves.
+		event_queue_lock.unlock();
+		event_queue_full_signal();
+		return true;
+	}
+	return false;
+}
+
+bool slirc::irc::check_low_water(boost::mutex::scoped_lock &event_queue_lock) {
+	if (
+		event_queue_above_high_water &&
+		event_queue.size() <= event_queue_low_water
+	) {
+		event_queue_above_high_water = false;
+		event_queue_lock.unlock();
+		event_queue_drained_signal();
+		return true;
+	}
+	return false;
+}
+
 void slirc::irc::handle(event::pointer pe) {
 	if (pe) {
 		while(pe->current_type != pe->event_type_history.end()) {
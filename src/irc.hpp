@@ -24,6 +24,7 @@
 #define LIBSLIRC_HDR_IRC_HPP_INCLUDED
 
 #include <deque>
+#include <iterator>
 #include <type_traits>
 #include <utility>
 
@@ -71,6 +72,12 @@ private:
 	boost::mutex event_queue_mutex;
 		std::deque<event::pointer> event_queue;
 		helper::waitable event_available_internal;
+		std::size_t event_queue_high_water;
+		std::size_t event_queue_low_water;
+		bool event_queue_above_high_water;
+
+	boost::signals2::signal<void()> event_queue_full_signal;
+	boost::signals2::signal<void()> event_queue_drained_signal;
 
 	struct signal_type {
 		boost::signals2::signal<void(event::pointer)> signal;
@@ -78,6 +85,15 @@ private:
 	};
 	std::map<std::type_index, signal_type> signals;
 
+	// Mark the queue as full or drained if a water mark has been crossed and
+	// call the respective handlers after unlocking the queue. Return whether
+	// a water mark has been crossed.
+	bool check_high_water(boost::mutex::scoped_lock &event_queue_lock);
+	bool check_low_water(boost::mutex::scoped_lock &event_queue_lock);
+
+	// Make a queued event call handle() once it is fetched.
+	void bind_handle(const event::pointer &newevent);
+
 public:
 	/**
 	 * \brief Creates an empty IRC context.
@@ -110,6 +126,49 @@ public:
 	 */
 	void queue_event(event::pointer newevent);
 
+	/**
+	 * \brief Queue several events to the event queue at once.
+	 *
+	 * The events are queued in order, all under a single lock, and waiting
+	 * threads are woken up only once. Prefer this to calling queue_event()
+	 * in a loop when producing events in bursts, e.g. one per line of a
+	 * chunk of received data.
+	 *
+	 * \param first The first event to add. Null pointers are skipped.
+	 * \param last The end of the events to add.
+	 *
+	 * \note This function is thread safe.
+	 */
+	template <typename InputIterator>
+	void queue_events(InputIterator first, InputIterator last) {
+		boost::mutex::scoped_lock lock(event_queue_mutex);
+		const std::size_t old_size = event_queue.size();
+		for(; first != last; ++first) {
+			const event::pointer &newevent = *first;
+			if (newevent) {
+				bind_handle(newevent);
+				event_queue.push_back(newevent);
+			}
+		}
+		if (event_queue.size() != old_size) {
+			event_available_internal.open();
+			check_high_water(lock);
+		}
+	}
+
+	/**
+	 * \brief Queue a range of events to the event queue at once.
+	 *
+	 * \param events A container of event::pointer, see
+	 *               queue_events(InputIterator, InputIterator).
+	 *
+	 * \note This function is thread safe.
+	 */
+	template <typename Range>
+	void queue_events(const Range &events) {
+		queue_events(std::begin(events), std::end(events));
+	}
+
 	/**
 	 * \brief Queue an event to the begin of the event queue.
 	 *
@@ -132,6 +191,61 @@ public:
 	 */
 	event::pointer fetch_event();
 
+	/**
+	 * \brief Returns the number of events in the queue.
+	 *
+	 * \note This function is thread safe.
+	 */
+	std::size_t event_queue_size();
+
+	/**
+	 * \brief Limits the event queue by water marks.
+	 *
+	 * Once the queue holds high_water events, the handlers attached with
+	 * on_event_queue_full() are called, e.g. to stop reading from the
+	 * network. Once it has been drained to low_water events, the handlers
+	 * attached with on_event_queue_drained() are called.
+	 *
+	 * The queue is not limited by default. Events are never dropped; the
+	 * water marks merely tell the producers to back off.
+	 *
+	 * \param high_water The number of events considered full, or 0 to
+	 *                   disable the water marks.
+	 * \param low_water The number of events considered drained. Must be
+	 *                  less than high_water.
+	 *
+	 * \note This function is thread safe.
+	 */
+	void set_event_queue_watermarks(std::size_t high_water, std::size_t low_water);
+
+	/**
+	 * \brief Checks whether the queue has reached the high water mark and
+	 *        not been drained to the low water mark since.
+	 *
+	 * \note This function is thread safe.
+	 */
+	bool event_queue_full();
+
+	/**
+	 * \brief Attaches a handler called when the queue reaches the high water
+	 *        mark.
+	 *
+	 * \param handler The handler, called by the thread queueing the event.
+	 *
+	 * \return The connection of the attached handler.
+	 */
+	boost::signals2::connection on_event_queue_full(std::function<void()> handler);
+
+	/**
+	 * \brief Attaches a handler called when a full queue has been drained
+	 *        to the low water mark.
+	 *
+	 * \param handler The handler, called by the thread fetching the event.
+	 *
+	 * \return The connection of the attached handler.
+	 */
+	boost::signals2::connection on_event_queue_drained(std::function<void()> handler);
+
 
 
 	///////////////////////////////////////////////////////////////////////////
@@ -173,6 +287,20 @@ public:
 		return sig.signal.connect(static_cast<int>(queue), handler);
 	}
 
+	/**
+	 * \brief Checks whether any handlers are attached to an event type.
+	 *
+	 * Producers of events may use this to skip work nobody is interested
+	 * in, e.g. parsing lines into events without handlers.
+	 *
+	 * \tparam EventType The event type to check.
+	 */
+	template<typename EventType>
+	bool is_subscribed() const {
+		auto it = signals.find(typeid(typename detail::event_type_check<EventType>::type));
+		return it != signals.end() && !it->second.signal.empty();
+	}
+
 	/**
 	 * \brief Handle an event.
 	 *
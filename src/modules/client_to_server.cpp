@@ -24,10 +24,100 @@
 
 #include "../apis/connection.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <utility>
 
 namespace arg = std::placeholders;
 
+namespace {
+	// FNV-1a hash of a command, usable as a case label
+	constexpr std::uint32_t command_hash(const char *command, std::size_t length, std::uint32_t hash = 2166136261u) {
+		return length
+			? command_hash(command + 1, length - 1, (hash ^ static_cast<unsigned char>(*command)) * 16777619u)
+			: hash;
+	}
+
+	template <std::size_t N>
+	constexpr std::uint32_t command_id(const char (&command)[N]) {
+		return command_hash(command, N - 1);
+	}
+
+	// checks whether an event type should be raised
+	template <typename EventType>
+	bool wanted(const slirc::irc &context, bool everything) {
+		return everything || context.is_subscribed<EventType>();
+	}
+
+	// queues an event for numeric_event_t<Number> if somebody handles it
+	template <unsigned Number>
+	bool queue_numeric(const slirc::irc &context, slirc::event &e) {
+		typedef slirc::apis::protocol::numeric_event_t<Number> event_type;
+		if (!context.is_subscribed<event_type>()) {
+			return false;
+		}
+		e.queue_as<event_type>();
+		return true;
+	}
+
+	// A list of indices 0..N-1, generated in log(N) recursion depth, so the
+	// compiler's template depth limit is no issue for the 1000 numerics.
+	template <unsigned... Indices>
+	struct index_list {};
+
+	template <typename First, typename Second>
+	struct concat_indices;
+
+	template <unsigned... First, unsigned... Second>
+	struct concat_indices<index_list<First...>, index_list<Second...>> {
+		typedef index_list<First..., (sizeof...(First) + Second)...> type;
+	};
+
+	template <unsigned N>
+	struct make_indices: concat_indices<
+		typename make_indices<N / 2>::type,
+		typename make_indices<N - N / 2>::type
+	> {};
+
+	template <>
+	struct make_indices<0> {
+		typedef index_list<> type;
+	};
+
+	template <>
+	struct make_indices<1> {
+		typedef index_list<0> type;
+	};
+
+	typedef bool (*numeric_queuer)(const slirc::irc &, slirc::event &);
+
+	template <typename Indices>
+	struct numeric_table;
+
+	// queue_numeric<N> for every numeric N, so looking one up is a single
+	// index instead of a chain of comparisons
+	template <unsigned... Numbers>
+	struct numeric_table<index_list<Numbers...>> {
+		static const numeric_queuer queuers[sizeof...(Numbers)];
+	};
+
+	template <unsigned... Numbers>
+	const numeric_queuer numeric_table<index_list<Numbers...>>::queuers[sizeof...(Numbers)] = {
+		&queue_numeric<Numbers>...
+	};
+
+	typedef numeric_table<make_indices<1000>::type> numerics;
+
+	// the same as command_hash(), without recursion for long input
+	std::uint32_t command_id(boost::string_ref command) {
+		std::uint32_t hash = 2166136261u;
+		for(char c: command) {
+			hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+		}
+		return hash;
+	}
+}
+
 slirc::modules::client_to_server::client_to_server(slirc::irc &context)
 : apis::protocol(context)
 , parserconn(context.attach<apis::connection::raw_irc_line_event>(
@@ -41,90 +131,207 @@ slirc::modules::client_to_server::~client_to_server() {
 void slirc::modules::client_to_server::parser(event::pointer ep) {
 	const std::string &line = ep->data.get<apis::connection::raw_irc_line>().line;
 
-	ep->queue_as<parsed_event>();
+	// Tags are only built for events somebody is waiting for. Handlers of
+	// parsed_event may look at any tag, so they get all of them.
+	const bool everything = irc.is_subscribed<parsed_event>();
+	if (everything) {
+		ep->queue_as<parsed_event>();
+	}
+
+	boost::string_ref rest = line;
+	if (!line.empty() && line[0] == '@') {
+		message_tags &tags = ep->data.set(message_tags());
+			rest = split_message_tags(line, tags);
+	}
 
-	parameters &prm = ep->data.set(parameters());
-		prm.params = irc_split(line);
+	// split into a local tag first; only attached if it is needed
+	parameters local_prm;
+	parameters &prm = everything ? ep->data.set(parameters()) : local_prm;
+		irc_split(rest, prm.params);
 
 	if (prm.params.empty()) {
 		return;
 	}
 
-	do {
+	// The commands are told apart by a switch over their hashes, so adding
+	// commands does not slow down the others. The compiler rejects hashes
+	// colliding among the cases; the command is compared once more only to
+	// rule out unknown commands of the same hash.
+	bool queued = false;
+	if (
+		// !prm.params[0].empty() && // Check unnecessary: Only the last
+		//   parameter can be empty if it is the literal extended parameter ":"
+		//   The first parameter cannot be an extended parameter, though.
+		prm.params[0][0] == ':'
+	) {
+		const std::size_t size = prm.params.size();
+		const boost::string_ref command = size < 2 ? boost::string_ref() : prm.params[1];
 		if (
-			// !prm.params[0].empty() && // Check unnecessary: Only the last
-			//   parameter can be empty if it is the literal extended parameter ":"
-			//   The first parameter cannot be an extended parameter, though.
-			prm.params[0][0] == ':'
+			command.size() == 3 &&
+			('0' <= command[0] && command[0] <= '9') &&
+			('0' <= command[1] && command[1] <= '9') &&
+			('0' <= command[2] && command[2] <= '9')
 		) {
-			origin &org = ep->data.set(origin());
-				org.origin_string = prm.params[0].substr(1);
-
-			if (prm.params.size() < 2) break;
-			else if (
-				prm.params[1].size() == 3 &&
-				('0' <= prm.params[1][0] && prm.params[1][0] <= '9') &&
-				('0' <= prm.params[1][1] && prm.params[1][1] <= '9') &&
-				('0' <= prm.params[1][2] && prm.params[1][2] <= '9')
-			) {
-				// NUMERIC
-				numeric &num = ep->data.set(numeric());
-					num.number =
-						(prm.params[1][0] - '0') * 100 +
-						(prm.params[1][1] - '0') * 10 +
-						(prm.params[1][2] - '0') * 1;
+			// NUMERIC
+			const unsigned number =
+				(command[0] - '0') * 100 +
+				(command[1] - '0') * 10 +
+				(command[2] - '0') * 1;
+			if (wanted<numeric_event>(irc, everything)) {
 				ep->queue_as<numeric_event>();
+				queued = true;
 			}
-			else if (prm.params[1] == "QUIT") {
-				if (2 < prm.params.size()) {
-					message &msg = ep->data.set(message());
-						msg.raw = prm.params[2];
-				}
-				ep->queue_as<quit_event>();
+			queued = numerics::queuers[number](irc, *ep) || queued;
+			if (queued) {
+				numeric &num = ep->data.set(numeric());
+					num.number = number;
 			}
-
-			else if (prm.params.size() < 3) break;
-			else if (prm.params[1] == "NICK") {
-				nick_change &nch = ep->data.set(nick_change());
-					nch.old_nick = prm.params[0].substr(0, prm.params[0].find('!'));
-					nch.new_nick = prm.params[2];
-				ep->queue_as<nick_event>();
+		}
+		else switch (command_id(command)) {
+		case command_id("INVITE"):
+			if (command == "INVITE" && 4 <= size && wanted<invite_event>(irc, everything)) {
+				recipient &rcp = ep->data.set(recipient());
+					rcp.recipient_string = prm.params[2].to_string();
+				invitation &inv = ep->data.set(invitation());
+					inv.channel = prm.params[3].to_string();
+				ep->queue_as<invite_event>();
+				queued = true;
+			}
+			break;
+		case command_id("JOIN"):
+			if (command == "JOIN" && 3 <= size && wanted<join_event>(irc, everything)) {
+				recipient &rcp = ep->data.set(recipient());
+					rcp.recipient_string = prm.params[2].to_string();
+				ep->queue_as<join_event>();
+				queued = true;
 			}
-			else if (prm.params[1] == "PART") {
+			break;
+		case command_id("KICK"):
+			if (command == "KICK" && 4 <= size && wanted<kick_event>(irc, everything)) {
 				recipient &rcp = ep->data.set(recipient());
-					rcp.recipient_string = prm.params[2];
-				if (3 < prm.params.size()) {
+					rcp.recipient_string = prm.params[2].to_string();
+				kick_target &kck = ep->data.set(kick_target());
+					kck.nick = prm.params[3].to_string();
+				if (4 < size) {
 					message &msg = ep->data.set(message());
-						msg.raw = prm.params[3];
+						msg.raw = prm.params[4].to_string();
 				}
-				ep->queue_as<quit_event>();
+				ep->queue_as<kick_event>();
+				queued = true;
 			}
-			else if (prm.params.size() < 4) break;
-			else if (
-				prm.params[1] == "NOTICE" ||
-				prm.params[1] == "PRIVMSG"
-			) {
+			break;
+		case command_id("MODE"):
+			if (command == "MODE" && 4 <= size && wanted<mode_event>(irc, everything)) {
 				recipient &rcp = ep->data.set(recipient());
-					rcp.recipient_string = prm.params[2];
+					rcp.recipient_string = prm.params[2].to_string();
+				mode_change &mch = ep->data.set(mode_change());
+					mch.modes = prm.params[3].to_string();
+					mch.first_argument = 4;
+				ep->queue_as<mode_event>();
+				queued = true;
+			}
+			break;
+		case command_id("NICK"):
+			if (command == "NICK" && 3 <= size && wanted<nick_event>(irc, everything)) {
+				nick_change &nch = ep->data.set(nick_change());
+					nch.old_nick = prm.params[0].substr(1, prm.params[0].find('!') - 1).to_string();
+					nch.new_nick = prm.params[2].to_string();
+				ep->queue_as<nick_event>();
+				queued = true;
+			}
+			break;
+		case command_id("NOTICE"):
+		case command_id("PRIVMSG"):
+			if ((command == "NOTICE" || command == "PRIVMSG") && 4 <= size && wanted<message_event>(irc, everything)) {
+				recipient &rcp = ep->data.set(recipient());
+					rcp.recipient_string = prm.params[2].to_string();
 				// TODO: CTCPs
 				message &msg = ep->data.set(message());
-					msg.type = prm.params[1][0] == 'P'
+					msg.type = command[0] == 'P'
 						? message::privmsg
 						: message::notice;
-					msg.raw = prm[3];
+					msg.raw = prm.params[3].to_string();
 
 				ep->queue_as<message_event>();
+				queued = true;
+			}
+			break;
+		case command_id("PART"):
+			if (command == "PART" && 3 <= size && wanted<part_event>(irc, everything)) {
+				recipient &rcp = ep->data.set(recipient());
+					rcp.recipient_string = prm.params[2].to_string();
+				if (3 < size) {
+					message &msg = ep->data.set(message());
+						msg.raw = prm.params[3].to_string();
+				}
+				ep->queue_as<part_event>();
+				queued = true;
+			}
+			break;
+		case command_id("QUIT"):
+			if (command == "QUIT" && wanted<quit_event>(irc, everything)) {
+				if (2 < size) {
+					message &msg = ep->data.set(message());
+						msg.raw = prm.params[2].to_string();
+				}
+				ep->queue_as<quit_event>();
+				queued = true;
 			}
+			break;
+		case command_id("TOPIC"):
+			if (command == "TOPIC" && 3 <= size && wanted<topic_event>(irc, everything)) {
+				recipient &rcp = ep->data.set(recipient());
+					rcp.recipient_string = prm.params[2].to_string();
+				message &msg = ep->data.set(message());
+				if (3 < size) {
+					msg.raw = prm.params[3].to_string();
+				}
+				ep->queue_as<topic_event>();
+				queued = true;
+			}
+			break;
+		case command_id("WALLOPS"):
+			if (command == "WALLOPS" && 3 <= size && wanted<wallops_event>(irc, everything)) {
+				message &msg = ep->data.set(message());
+					msg.raw = prm.params[2].to_string();
+				ep->queue_as<wallops_event>();
+				queued = true;
+			}
+			break;
 		}
-		else {
-			// Check for commands ... well ... at least for what we know:
 
-			if (prm.params.size() < 2) break;
-			else if (prm.params[0] == "PING" && prm.params) {
+		if (queued || everything) {
+			origin &org = ep->data.set(origin());
+				org.origin_string = prm.params[0].substr(1).to_string();
+		}
+	}
+	else {
+		// Check for commands ... well ... at least for what we know:
+		if (prm.params.size() < 2) {
+			return;
+		}
+		const boost::string_ref command = prm.params[0];
+		switch (command_id(command)) {
+		case command_id("ERROR"):
+			if (command == "ERROR" && wanted<error_event>(irc, everything)) {
+				message &msg = ep->data.set(message());
+					msg.raw = prm.params[1].to_string();
+				ep->queue_as<error_event>();
+				queued = true;
+			}
+			break;
+		case command_id("PING"):
+			if (command == "PING" && wanted<ping_event>(irc, everything)) {
 				message &msg = ep->data.set(message());
-					msg.raw = prm.params[1];
+					msg.raw = prm.params[1].to_string();
 				ep->queue_as<ping_event>();
+				queued = true;
 			}
+			break;
 		}
-	} while(0);
+	}
+
+	if (queued && !everything) {
+		ep->data.set(std::move(local_prm));
+	}
 }
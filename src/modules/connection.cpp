@@ -22,36 +22,304 @@
 
 #include "connection.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
 
 #include "../irc.hpp"
+#include "../network.hpp"
 #include "../network/connection.hpp"
 
 namespace {
+	typedef slirc::helper::pinned_pointer<slirc::network::connection>::pin send_target_pin;
+
 	const std::string whitespace("\0\t\r\n ", 5);
-	const std::string lineending("\r\n", 2);
+
+	// splits a connection string into host name and port
+	void parse_hostport(const std::string &hostport, std::string &hostname, unsigned &port) {
+		hostname = hostport;
+		port = 6667;
+
+		if (hostname.substr(0, 6) == "irc://") {
+			hostname.erase(0, 6);
+		}
+		else if (hostname.substr(0, 7) == "ircs://") {
+			hostname.erase(0, 7);
+			// todo: enable SSL
+		}
+
+		std::string::size_type pos = hostname.find_last_not_of("0123456789");
+		if (pos != hostname.npos && pos != hostname.size()-1 && hostname[pos] == ':') {
+			// Yay! port number!
+			port = std::stoul(hostname.substr(pos+1));
+			hostname.erase(pos);
+		}
+	}
+
+	typedef slirc::apis::connection::send_priority send_priority;
+
+	// returns the next space separated word of a line
+	std::string next_word(const std::string &line, std::string::size_type &pos) {
+		pos = line.find_first_not_of(' ', pos);
+		if (pos == line.npos) {
+			return std::string();
+		}
+		std::string::size_type end = line.find_first_of(" \r\n", pos);
+		if (end == line.npos) {
+			end = line.size();
+		}
+		std::string word = line.substr(pos, end - pos);
+		pos = end;
+		return word;
+	}
+
+	// Determines the priority of a line sent without an explicit one and
+	// its target, i.e. the first parameter.
+	send_priority classify_line(const std::string &line, std::string &target) {
+		std::string::size_type pos = 0;
+		std::string command = next_word(line, pos);
+		if (!command.empty() && command[0] == ':') {
+			command = next_word(line, pos); // skip the prefix
+		}
+		for(char &c: command) {
+			c = std::toupper(static_cast<unsigned char>(c));
+		}
+
+		target = next_word(line, pos);
+		if (!target.empty() && target[0] == ':') {
+			target.clear(); // trailing parameter, not a target
+		}
+
+		static const char *const urgent_commands[] = {
+			"PONG", "PING", "PASS", "CAP", "AUTHENTICATE", "NICK", "USER", "QUIT"
+		};
+		for(const char *urgent_command: urgent_commands) {
+			if (command == urgent_command) {
+				return send_priority::urgent;
+			}
+		}
+		return send_priority::interactive;
+	}
+
+	// the number of lines in a chunk of outgoing data
+	unsigned count_lines(const std::string &data) {
+		const unsigned lines = std::count(data.begin(), data.end(), '\n');
+		return lines ? lines : 1;
+	}
 }
 
+struct slirc::modules::connection::reconnect_state {
+	reconnect_state(boost::asio::io_service &service, connection *owner)
+	: owner(owner)
+	, timer(service)
+	, attempt(0)
+	, server_index(0)
+	, disconnect_requested(false)
+	, rng(std::random_device()())
+	{}
+
+	// Shared with the timer handler, which may run after the connection has
+	// been destroyed; reset by the destructor of the connection.
+	boost::mutex owner_mutex;
+		connection *owner;
+
+	reconnect_policy policy;
+	std::vector<std::pair<std::string, unsigned>> servers; // primary first
+	boost::asio::steady_timer timer;
+	unsigned attempt; // number of the last reconnect attempt
+	std::chrono::steady_clock::time_point connected_at; // when the last attempt succeeded
+	std::size_t server_index; // index of the server currently in use
+	bool disconnect_requested; // set by disconnect(), suppresses reconnects
+	std::mt19937 rng;
+};
+
+struct slirc::modules::connection::flood_state {
+	// data queued for a single target
+	struct queued_data {
+		helper::shared_buffer data;
+		unsigned lines;
+	};
+
+	// the queued data of a single priority class
+	struct priority_class {
+		priority_class()
+		: lines(0)
+		{}
+
+		std::map<std::string, std::deque<queued_data>> targets;
+		std::deque<std::string> turns; // targets with queued data, next one first
+		std::size_t lines; // number of queued lines
+	};
+
+	flood_state(boost::asio::io_service &service, connection *owner)
+	: pacing(false)
+	, owner(owner)
+	, timer(service)
+	, timer_pending(false)
+	, tokens(0)
+	, last_refill(std::chrono::steady_clock::now())
+	{}
+
+	// gains the tokens accumulated since the last refill
+	void refill() {
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (policy.line_interval.count() > 0) {
+			tokens += static_cast<double>((now - last_refill).count()) /
+				std::chrono::duration_cast<std::chrono::steady_clock::duration>(policy.line_interval).count();
+		}
+		else {
+			tokens = policy.burst;
+		}
+		tokens = std::min(tokens, static_cast<double>(policy.burst));
+		last_refill = now;
+	}
+
+	std::size_t lines() const {
+		std::size_t result = 0;
+		for(const priority_class &queue: queues) {
+			result += queue.lines;
+		}
+		return result;
+	}
+
+	// mirrors policy.enabled, so unpaced sends do not need the mutex
+	std::atomic<bool> pacing;
+
+	// Shared with the timer handler, which may run after the connection has
+	// been destroyed.
+	mutable boost::mutex mutex;
+		connection *owner; // reset by the destructor of the connection
+		flood_policy policy;
+		boost::asio::steady_timer timer;
+		bool timer_pending;
+		double tokens;
+		std::chrono::steady_clock::time_point last_refill;
+		// indexed by send_priority
+		priority_class queues[3];
+};
+
+slirc::modules::connection::flood_policy::flood_policy()
+: enabled(false)
+, burst(5)
+, line_interval(std::chrono::seconds(2)) {}
+
+slirc::modules::connection::reconnect_policy::reconnect_policy()
+: enabled(false)
+, initial_delay(std::chrono::seconds(1))
+, max_delay(std::chrono::minutes(5))
+, multiplier(2.0)
+, jitter(0.5)
+, max_attempts(0)
+, stable_after(std::chrono::minutes(1)) {}
+
 slirc::modules::connection::connection(slirc::irc &context, const std::string &hostport)
+: connection(context, hostport, network::service) {}
+
+slirc::modules::connection::connection(slirc::irc &context, const std::string &hostport, boost::asio::io_service &service)
 : apis::connection(context)
+, io(service)
 , conn()
 , connstat(connection_status::disconnected)
-, hostname(hostport)
-, port(6667) {
-	if (hostname.substr(0, 6) == "irc://") {
-		hostname.erase(0, 6);
+, reconnect(std::make_shared<reconnect_state>(service, this))
+, send_high_water(0)
+, send_low_water(0) {
+	parse_hostport(hostport, hostname, port);
+	reconnect->servers.emplace_back(hostname, port);
+	flood = std::make_shared<flood_state>(service, this);
+
+	event_queue_full_connection = irc.on_event_queue_full([this]() {
+		update_recv_pause();
+	});
+	event_queue_drained_connection = irc.on_event_queue_drained([this]() {
+		update_recv_pause();
+	});
+}
+
+slirc::modules::connection::~connection() {
+	// Necessary: Destruction involves destructing the reconnect state, which
+	// is not known to a generated destructor.
+	{ boost::mutex::scoped_lock owner_lock(reconnect->owner_mutex);
+		// waits for a running timer handler
+		reconnect->owner = nullptr;
 	}
-	else if (hostname.substr(0, 7) == "ircs://") {
-		hostname.erase(0, 7);
-		// todo: enable SSL
+	boost::mutex::scoped_lock lock(api_mutex);
+	reconnect->disconnect_requested = true;
+	boost::system::error_code ignored_error;
+	reconnect->timer.cancel(ignored_error);
+
+	boost::mutex::scoped_lock flood_lock(flood->mutex);
+	// waits for a running timer handler
+	flood->owner = nullptr;
+	flood->timer.cancel(ignored_error);
+}
+
+void slirc::modules::connection::set_reconnect_policy(const reconnect_policy &policy) {
+	boost::mutex::scoped_lock lock(api_mutex);
+	reconnect->policy = policy;
+	reconnect->policy.jitter = std::min(1.0, std::max(0.0, policy.jitter));
+
+	reconnect->servers.resize(1);
+	for(const std::string &hostport: policy.alternate_servers) {
+		std::string alternate_hostname;
+		unsigned alternate_port;
+		parse_hostport(hostport, alternate_hostname, alternate_port);
+		reconnect->servers.emplace_back(alternate_hostname, alternate_port);
+	}
+}
+
+void slirc::modules::connection::set_flood_policy(const flood_policy &policy) {
+	boost::mutex::scoped_lock lock(flood->mutex);
+	flood->policy = policy;
+	// Lines are sent with a full bucket at the latest.
+	flood->policy.burst = std::max(1u, policy.burst);
+	flood->pacing = policy.enabled;
+	flood->tokens = flood->policy.burst;
+	flood->last_refill = std::chrono::steady_clock::now();
+	// Lines may have been queued under the old policy.
+	send_queued(lock);
+}
+
+void slirc::modules::connection::set_send_watermarks(std::size_t high_water, std::size_t low_water) {
+	boost::mutex::scoped_lock lock(api_mutex);
+	send_high_water = high_water;
+	send_low_water = low_water;
+	if (conn) {
+		conn->set_send_watermarks(high_water, low_water);
+	}
+}
+
+void slirc::modules::connection::set_capture_file(const std::string &path) {
+	boost::mutex::scoped_lock lock(api_mutex);
+	capture_path = path;
+}
+
+std::size_t slirc::modules::connection::inject(const char *data, std::size_t length) {
+	// The receive path frames lines without locking. It is idle while
+	// disconnected, and connecting needs the mutex held here.
+	boost::mutex::scoped_lock lock(api_mutex);
+	if (connstat != connection_status::disconnected) {
+		throw std::logic_error("inject called while connected");
 	}
+	return frame_lines(data, length);
+}
 
-	std::string::size_type pos = hostname.find_last_not_of("0123456789");
-	if (pos != hostname.npos && pos != hostname.size()-1 && hostname[pos] == ':') {
-		// Yay! port number!
-		port = std::stoul(hostname.substr(pos+1));
-		hostname.erase(pos);
+void slirc::modules::connection::end_inject() {
+	boost::mutex::scoped_lock lock(api_mutex);
+	if (connstat != connection_status::disconnected) {
+		throw std::logic_error("end_inject called while connected");
 	}
+	framer.reset();
 }
 
 void slirc::modules::connection::connect() {
@@ -59,44 +327,21 @@ void slirc::modules::connection::connect() {
 	if (connstat != connection_status::disconnected) {
 		return;
 	}
-	assert(!conn);
-	change_status(connection_status::connecting, lock);
 
-	conn.reset(new network::connection());
-	conn->on_status([&](const boost::system::error_code &error) {
-		boost::mutex::scoped_lock lock(api_mutex);
-		if (error) {
-			change_status(connection_status::disconnected, lock);
-		}
-		else if (connstat == connection_status::connecting) {
-			change_status(connection_status::connected, lock);
-		}
-	});
-	conn->on_recv([&](const std::string &netdata){
-		read_buffer += netdata;
-		std::string::size_type pos;
-		while (read_buffer.npos != (pos = read_buffer.find_first_of(lineending))) {
-			std::string line = read_buffer.substr(0, pos);
-			read_buffer.erase(0, pos+1);
-
-			pos = line.find_first_not_of(whitespace);
-			if (pos != line.npos) {
-				line.erase(0, pos);
-
-				event::pointer pe = event::create<raw_irc_line_event>();
-				{ raw_irc_line tag_ril;
-					tag_ril.line = line;
-					pe->data.set(tag_ril);
-				}
-				irc.queue_event(pe);
-			}
-		}
-	});
-	conn->connect(hostname, port);
+	reconnect->disconnect_requested = false;
+	reconnect->attempt = 0;
+	boost::system::error_code ignored_error;
+	reconnect->timer.cancel(ignored_error);
+
+	start_connect(lock);
 }
 
 void slirc::modules::connection::disconnect() {
 	boost::mutex::scoped_lock lock(api_mutex);
+	reconnect->disconnect_requested = true;
+	boost::system::error_code ignored_error;
+	reconnect->timer.cancel(ignored_error);
+
 	if (conn) {
 		conn->disconnect();
 	}
@@ -107,14 +352,338 @@ slirc::apis::connection::connection_status slirc::modules::connection::status()
 	return connstat;
 }
 
+template <typename Data>
+bool slirc::modules::connection::send_unpaced(const Data &data) {
+	if (flood->pacing) {
+		return false;
+	}
+	send_target_pin current_conn(send_target);
+	if (current_conn) {
+		current_conn->send(data);
+	}
+	return true;
+}
+
 void slirc::modules::connection::send(const std::string &data) {
-	boost::mutex::scoped_lock lock(api_mutex);
-	if (conn && connstat == connection_status::connected) {
-		conn->send(data);
+	if (!send_unpaced(data)) {
+		send_paced(helper::make_shared_buffer(data), send_priority::interactive, true);
+	}
+}
+
+void slirc::modules::connection::send(const helper::shared_buffer &data) {
+	if (!data) {
+		return; // like an empty buffer
+	}
+	if (!send_unpaced(data)) {
+		send_paced(data, send_priority::interactive, true);
+	}
+}
+
+void slirc::modules::connection::send(const std::string &data, send_priority priority) {
+	if (!send_unpaced(data)) {
+		send_paced(helper::make_shared_buffer(data), priority, false);
+	}
+}
+
+void slirc::modules::connection::send(const helper::shared_buffer &data, send_priority priority) {
+	if (!data) {
+		return; // like an empty buffer
+	}
+	if (!send_unpaced(data)) {
+		send_paced(data, priority, false);
+	}
+}
+
+std::size_t slirc::modules::connection::queued_lines() const {
+	boost::mutex::scoped_lock lock(flood->mutex);
+	return flood->lines();
+}
+
+std::size_t slirc::modules::connection::queued_lines(send_priority priority) const {
+	boost::mutex::scoped_lock lock(flood->mutex);
+	return flood->queues[static_cast<int>(priority)].lines;
+}
+
+void slirc::modules::connection::send_paced(const helper::shared_buffer &data, send_priority priority, bool derive_priority) {
+	send_target_pin current_conn(send_target);
+	if (!current_conn) {
+		return; // not connected
+	}
+
+	boost::mutex::scoped_lock lock(flood->mutex);
+	if (!flood->policy.enabled) {
+		lock.unlock();
+		current_conn->send(data);
+		return;
+	}
+
+	const unsigned lines = count_lines(*data);
+	flood->refill();
+	if (flood->lines() == 0 && flood->tokens >= lines) {
+		// nothing to wait for
+		flood->tokens -= lines;
+		current_conn->send(data);
+		return;
+	}
+
+	// Only lines that have to wait are looked at.
+	std::string target;
+	const send_priority line_priority = classify_line(*data, target);
+	if (derive_priority) {
+		priority = line_priority;
+	}
+	flood_state::priority_class &queue = flood->queues[static_cast<int>(priority)];
+	std::deque<flood_state::queued_data> &target_queue = queue.targets[target];
+	if (target_queue.empty()) {
+		queue.turns.push_back(target);
+	}
+	flood_state::queued_data queued = { data, lines };
+	target_queue.push_back(queued);
+	queue.lines += lines;
+
+	send_queued(lock);
+}
+
+void slirc::modules::connection::send_queued(boost::mutex::scoped_lock &flood_mutex_lock) {
+	static_cast<void>(flood_mutex_lock); // possibly unused parameter in NDEBUG
+	assert(flood_mutex_lock);
+
+	send_target_pin current_conn(send_target);
+	if (!current_conn) {
+		return; // the queue is cleared on disconnect
+	}
+
+	flood->refill();
+	double needed = 1.0; // tokens needed for the next queued line
+	for(flood_state::priority_class &queue: flood->queues) {
+		while (!queue.turns.empty()) {
+			// the target whose turn it is
+			auto it = queue.targets.find(queue.turns.front());
+			assert(it != queue.targets.end() && !it->second.empty());
+			const flood_state::queued_data &next = it->second.front();
+
+			// Lines longer than a full bucket can only be sent with a full
+			// bucket.
+			needed = std::min(next.lines, flood->policy.burst);
+			if (flood->tokens < needed && flood->policy.enabled) {
+				break;
+			}
+
+			current_conn->send(next.data);
+			flood->tokens -= next.lines;
+			queue.lines -= next.lines;
+			it->second.pop_front();
+
+			std::string target = std::move(queue.turns.front());
+			queue.turns.pop_front();
+			if (it->second.empty()) {
+				queue.targets.erase(it);
+			}
+			else {
+				queue.turns.push_back(std::move(target));
+			}
+		}
+		if (!queue.turns.empty()) {
+			break; // lower priorities have to wait
+		}
+	}
+
+	if (flood->lines() && !flood->timer_pending) {
+		// wait until the next token is available
+		const double missing = std::max(needed - flood->tokens, 0.0);
+		flood->timer_pending = true;
+		flood->timer.expires_from_now(std::chrono::milliseconds(
+			static_cast<std::chrono::milliseconds::rep>(std::ceil(missing * flood->policy.line_interval.count()))));
+		std::shared_ptr<flood_state> state = flood;
+		flood->timer.async_wait([state](const boost::system::error_code &error) {
+			if (error) {
+				return; // cancelled, possibly by the destructor
+			}
+			boost::mutex::scoped_lock lock(state->mutex);
+			state->timer_pending = false;
+			if (state->owner) {
+				state->owner->send_queued(lock);
+			}
+		});
+	}
+}
+
+void slirc::modules::connection::update_recv_pause() {
+	// The handlers of the water marks may race each other, so the current
+	// state is checked instead of relying on the order of the calls.
+	boost::mutex::scoped_lock lock(recv_pause_mutex);
+	send_target_pin current_conn(send_target);
+	if (current_conn) {
+		if (irc.event_queue_full()) {
+			current_conn->pause_recv();
+		}
+		else {
+			current_conn->resume_recv();
+		}
+	}
+}
+
+void slirc::modules::connection::clear_send_queue() {
+	boost::mutex::scoped_lock lock(flood->mutex);
+	for(flood_state::priority_class &queue: flood->queues) {
+		queue = flood_state::priority_class();
 	}
+	flood->tokens = flood->policy.burst;
+	flood->timer_pending = false;
+	boost::system::error_code ignored_error;
+	flood->timer.cancel(ignored_error);
 }
 
-void slirc::modules::connection::change_status(connection_status newstatus, boost::mutex::scoped_lock &api_mutex_lock) {
+std::size_t slirc::modules::connection::frame_lines(const char *data, std::size_t length) {
+	const std::size_t consumed = framer.frame(data, length, [this](const char *begin, std::size_t line_length) {
+		const char *const eol = begin + line_length;
+		const char *line = std::find_if(begin, eol, [](char c) {
+			return whitespace.npos == whitespace.find(c);
+		});
+
+		if (line != eol) {
+			event::pointer pe = event::create<raw_irc_line_event>();
+			{ raw_irc_line tag_ril;
+				tag_ril.line.assign(line, eol);
+				pe->data.set(tag_ril);
+			}
+			line_batch.push_back(pe);
+		}
+	});
+	// one lock and one wakeup for all lines of a read
+	irc.queue_events(line_batch);
+	line_batch.clear();
+	return consumed;
+}
+
+void slirc::modules::connection::start_connect(boost::mutex::scoped_lock &api_mutex_lock) {
+	change_status(connection_status::connecting, api_mutex_lock, reconnect->attempt);
+
+	// Replacing an old connection is safe: its status handler has already
+	// reported the connection as lost.
+	conn = std::make_shared<network::connection>(io);
+	framer.reset();
+	network::connection *current_conn = conn.get();
+	conn->on_status([&, current_conn](const boost::system::error_code &error) {
+		boost::mutex::scoped_lock lock(api_mutex);
+		if (conn.get() != current_conn) {
+			return; // late news from a connection that has been replaced
+		}
+
+		if (error) {
+			if (
+				connstat == connection_status::connected &&
+				std::chrono::steady_clock::now() - reconnect->connected_at >= reconnect->policy.stable_after
+			) {
+				// the connection was fine for a while - start backing off anew
+				reconnect->attempt = 0;
+			}
+			// Every failing operation reports the loss, but it is only
+			// handled once.
+			const bool lost = connstat != connection_status::disconnected;
+			send_target.reset(nullptr);
+			clear_send_queue();
+			change_status(connection_status::disconnected, lock);
+			if (lost) {
+				schedule_reconnect(lock);
+			}
+		}
+		else if (connstat == connection_status::connecting) {
+			reconnect->connected_at = std::chrono::steady_clock::now();
+			send_target.reset(conn.get());
+			// the event queue may have filled up in the meantime
+			update_recv_pause();
+			change_status(connection_status::connected, lock);
+		}
+	});
+	conn->on_recv_view([&](const char *netdata, std::size_t length){
+		return frame_lines(netdata, length);
+	});
+	conn->set_send_watermarks(send_high_water, send_low_water);
+	if (!capture_path.empty()) {
+		try {
+			conn->start_capture(capture_path);
+		}
+		catch (const std::runtime_error &) {
+			// Recording is a debugging aid, it must not keep us offline.
+		}
+	}
+	// The handler is run by the implementation of the connection, which may
+	// outlive it.
+	std::weak_ptr<network::connection> weak_conn = conn;
+	conn->on_send_pressure([&, weak_conn](bool congested) {
+		std::shared_ptr<network::connection> pressured_conn = weak_conn.lock();
+		if (!pressured_conn) {
+			return;
+		}
+		event::pointer pe = event::create<send_pressure_event>();
+		{ send_pressure tag_sp;
+			tag_sp.congested = congested;
+			tag_sp.queued_bytes = pressured_conn->send_queue_size();
+			pe->data.set(tag_sp);
+		}
+		irc.queue_event(pe);
+	});
+	conn->connect(hostname, port);
+}
+
+void slirc::modules::connection::schedule_reconnect(boost::mutex::scoped_lock &api_mutex_lock) {
+	static_cast<void>(api_mutex_lock); // possibly unused parameter in NDEBUG
+	assert(api_mutex_lock);
+
+	const reconnect_policy &policy = reconnect->policy;
+	if (
+		!policy.enabled ||
+		reconnect->disconnect_requested ||
+		(policy.max_attempts && reconnect->attempt >= policy.max_attempts)
+	) {
+		return;
+	}
+
+	++reconnect->attempt;
+	if (reconnect->attempt > 1) {
+		// the current server did not work out - try the next one
+		reconnect->server_index = (reconnect->server_index + 1) % reconnect->servers.size();
+	}
+
+	// exponential backoff ...
+	double delay = policy.initial_delay.count() *
+		std::pow(policy.multiplier, reconnect->attempt - 1);
+	delay = std::min(delay, static_cast<double>(policy.max_delay.count()));
+	// ... with jitter, so many contexts losing their connections at the same
+	// time do not all come back at the same time
+	std::uniform_real_distribution<double> random_factor(1.0 - policy.jitter, 1.0);
+	delay *= random_factor(reconnect->rng);
+
+	reconnect->timer.expires_from_now(
+		std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(delay)));
+	std::shared_ptr<reconnect_state> state = reconnect;
+	reconnect->timer.async_wait([state](const boost::system::error_code &error) {
+		if (error == boost::asio::error::operation_aborted) {
+			return; // cancelled, possibly by the destructor
+		}
+		boost::mutex::scoped_lock owner_lock(state->owner_mutex);
+		connection *self = state->owner;
+		if (!self) {
+			return; // destroyed after the timer expired
+		}
+
+		boost::mutex::scoped_lock lock(self->api_mutex);
+		if (
+			error ||
+			state->disconnect_requested ||
+			self->connstat != connection_status::disconnected
+		) {
+			return; // cancelled
+		}
+
+		self->hostname = state->servers[state->server_index].first;
+		self->port = state->servers[state->server_index].second;
+		self->start_connect(lock);
+	});
+}
+
+void slirc::modules::connection::change_status(connection_status newstatus, boost::mutex::scoped_lock &api_mutex_lock, unsigned reconnect_attempt) {
 	static_cast<void>(api_mutex_lock); // possibly unused parameter in NDEBUG
 	assert(api_mutex_lock);
 
@@ -125,6 +694,12 @@ void slirc::modules::connection::change_status(connection_status newstatus, boos
 			tag_sc.new_status = newstatus;
 			pe->data.set(tag_sc);
 		}
+		if (reconnect_attempt) {
+			reconnect_info tag_ri;
+				tag_ri.attempt = reconnect_attempt;
+				tag_ri.server = hostname + ":" + std::to_string(port);
+			pe->data.set(tag_ri);
+		}
 		connstat = newstatus;
 		irc.queue_event(pe);
 	}
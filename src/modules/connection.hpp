@@ -25,10 +25,18 @@
 
 #include "../apis/connection.hpp"
 
+#include <chrono>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include <boost/signals2/connection.hpp>
 #include <boost/thread/mutex.hpp>
 
+#include "../helper/line_framer.hpp"
+#include "../helper/pinned_pointer.hpp"
+#include "../network.hpp"
+
 namespace slirc { namespace network {
 	struct connection;
 }}
@@ -53,11 +61,168 @@ struct connection: apis::connection {
 	 */
 	connection(slirc::irc &context, const std::string &hostport);
 
+	/**
+	 * \brief Sets up a connection handler to a server that is run by an
+	 *        application supplied io_service.
+	 *
+	 * All network I/O and reconnect timers of this connection are run by the
+	 * given io_service instead of libslirc's own (network::service), so the
+	 * connection can share an event loop with the rest of the application.
+	 * Events are still queued in the IRC context as usual.
+	 *
+	 * \param context The IRC context this module is loaded in. Will be passed
+	 *                implicitly when loading the module.
+	 * \param hostport The connection string, see above.
+	 * \param service The io_service to run the connection on. It has to
+	 *                outlive the module.
+	 */
+	connection(slirc::irc &context, const std::string &hostport, boost::asio::io_service &service);
+
+	/**
+	 * \brief Destructs the connection handler.
+	 */
+	~connection();
+
+	/**
+	 * \brief Describes if and how lost connections are reestablished.
+	 *
+	 * The delay before the n-th attempt is initial_delay * multiplier^(n-1),
+	 * but no more than max_delay. It is then reduced by a random fraction of
+	 * up to jitter, so contexts that lost their connections at the same time
+	 * do not all try to reconnect at the same time.
+	 */
+	struct reconnect_policy {
+		/// Initializes a disabled policy with reasonable values.
+		reconnect_policy();
+
+		bool enabled; ///< \brief Whether to reconnect automatically at all.
+		std::chrono::milliseconds initial_delay; ///< \brief The delay before the first attempt.
+		std::chrono::milliseconds max_delay; ///< \brief The longest delay between two attempts.
+		double multiplier; ///< \brief The factor the delay grows by with each attempt.
+		double jitter; ///< \brief The maximum fraction (clamped to 0..1) by which a delay is randomly reduced.
+		unsigned max_attempts; ///< \brief The number of attempts before giving up; 0 for no limit.
+		/**
+		 * \brief How long a connection has to last to reset the backoff.
+		 *
+		 * Connections lost earlier count as failed attempts, so a server
+		 * dropping connections right after accepting them is not hammered.
+		 */
+		std::chrono::milliseconds stable_after;
+		/**
+		 * \brief Further servers in the same form as the constructors hostport
+		 *        parameter.
+		 *
+		 * Each failed attempt moves on to the next server, starting over with
+		 * the primary server after the last one.
+		 */
+		std::vector<std::string> alternate_servers;
+	};
+
+	/**
+	 * \brief Sets up automatic reconnecting.
+	 *
+	 * If enabled, every loss of the connection or failed connection attempt
+	 * that has not been caused by disconnect() schedules another attempt.
+	 * Each attempt is reported by a status_change_event with an additional
+	 * reconnect_info tag.
+	 *
+	 * \param policy The reconnect policy to use.
+	 */
+	void set_reconnect_policy(const reconnect_policy &policy);
+
+	/**
+	 * \brief Describes how outgoing lines are paced to avoid being
+	 *        disconnected for flooding.
+	 *
+	 * Lines are sent as long as there are tokens left in a bucket holding up
+	 * to burst tokens. Every line takes one token, and one token is regained
+	 * every line_interval. Lines that cannot be sent right away are queued:
+	 * urgent lines first, then interactive ones, then bulk ones. Within a
+	 * priority class, the targets of the lines (e.g. channels or nick names)
+	 * take turns, so a long reply to one target does not hold back the others.
+	 */
+	struct flood_policy {
+		/// Initializes a disabled policy with reasonable values.
+		flood_policy();
+
+		bool enabled; ///< \brief Whether to pace outgoing lines at all.
+		unsigned burst; ///< \brief The number of lines that can be sent at once (at least 1).
+		std::chrono::milliseconds line_interval; ///< \brief The time it takes to regain a token.
+	};
+
+	/**
+	 * \brief Sets up pacing of outgoing lines.
+	 *
+	 * send() without an explicit priority sends PONG, PING and the
+	 * registration commands (PASS, CAP, AUTHENTICATE, NICK, USER) as well as
+	 * QUIT with send_priority::urgent, everything else with
+	 * send_priority::interactive.
+	 *
+	 * \param policy The flood policy to use.
+	 */
+	void set_flood_policy(const flood_policy &policy);
+
+	/**
+	 * \brief Sets the water marks of the data waiting to be sent.
+	 *
+	 * Reaching the high water mark and draining to the low water mark again
+	 * are reported by a send_pressure_event. Lines held back by the flood
+	 * policy are not counted.
+	 *
+	 * \param high_water The number of bytes considered too many, or 0 (the
+	 *                   default) to disable the water marks.
+	 * \param low_water The number of bytes considered few enough again. Must
+	 *                  be less than high_water.
+	 */
+	void set_send_watermarks(std::size_t high_water, std::size_t low_water);
+
+	/**
+	 * \brief Records the traffic of all future connections to a file.
+	 *
+	 * The file is overwritten whenever a new connection is set up, e.g. on
+	 * reconnect. It can be read by testing::capture_file.
+	 *
+	 * \param path The file to write to, or an empty string (the default) to
+	 *             stop recording.
+	 */
+	void set_capture_file(const std::string &path);
+
+	/**
+	 * \brief Handles data as if it had been received from the server.
+	 *
+	 * Used to replay recorded traffic, see testing::replay_capture().
+	 *
+	 * \param data A pointer to the data.
+	 * \param length The number of bytes available at data.
+	 *
+	 * \return The number of bytes consumed. The remaining data is an
+	 *         incomplete line and has to be passed again with more data.
+	 *
+	 * \throw std::logic_error if the connection is not disconnected, as the
+	 *        data would interleave with the data received.
+	 */
+	std::size_t inject(const char *data, std::size_t length);
+
+	/**
+	 * \brief Ends the data passed to inject().
+	 *
+	 * Forgets an overlong line being dropped, so the next data passed to
+	 * inject() starts with a fresh line, just like a new connection does.
+	 *
+	 * \throw std::logic_error if the connection is not disconnected.
+	 */
+	void end_inject();
+
 	// inherited from API
 	void connect() override;
 	void disconnect() override;
 	connection_status status() const override;
 	void send(const std::string &data) override;
+	void send(const helper::shared_buffer &data) override;
+	void send(const std::string &data, send_priority priority) override;
+	void send(const helper::shared_buffer &data, send_priority priority) override;
+	std::size_t queued_lines() const override;
+	std::size_t queued_lines(send_priority priority) const override;
 
 protected:
 	/**
@@ -67,16 +232,119 @@ protected:
 	 *                  connstat, no event will be raised.
 	 * \param api_mutex_lock A reference to the lock currently holding
 	 *                       api_mutex.
+	 * \param reconnect_attempt The number of the reconnect attempt causing
+	 *                          the change, if any.
+	 */
+	void change_status(connection_status newstatus, boost::mutex::scoped_lock &api_mutex_lock, unsigned reconnect_attempt = 0);
+
+	/**
+	 * \brief Sets up a new network::connection and starts connecting.
+	 *
+	 * \param api_mutex_lock A reference to the lock currently holding
+	 *                       api_mutex.
+	 */
+	void start_connect(boost::mutex::scoped_lock &api_mutex_lock);
+
+	/**
+	 * \brief Sends data right away if the flood policy is disabled.
+	 *
+	 * \param data The data to send.
+	 *
+	 * \return false if the data has to be paced instead.
+	 */
+	template <typename Data>
+	bool send_unpaced(const Data &data);
+
+	/**
+	 * \brief Sends data right away or queues it, depending on the flood
+	 *        policy.
+	 *
+	 * \param data The data to send.
+	 * \param priority The priority class of the data.
+	 * \param derive_priority Whether to derive the priority class from the
+	 *                        command instead, if the data has to be queued.
+	 */
+	void send_paced(const helper::shared_buffer &data, send_priority priority, bool derive_priority);
+
+	/**
+	 * \brief Sends as many queued lines as the flood policy allows and
+	 *        schedules sending the rest.
+	 *
+	 * \param flood_mutex_lock A reference to the lock currently holding the
+	 *                         mutex of the flood state.
+	 */
+	void send_queued(boost::mutex::scoped_lock &flood_mutex_lock);
+
+	/**
+	 * \brief Drops all queued lines.
 	 */
-	void change_status(connection_status newstatus, boost::mutex::scoped_lock &api_mutex_lock);
+	void clear_send_queue();
 
-	mutable boost::mutex api_mutex; ///< \brief Mutex guarding conn, connstat and read_buffer.
-		std::unique_ptr<network::connection> conn; ///< \brief The network::connection, if one is established.
+	/**
+	 * \brief Pauses or resumes receiving, depending on whether the event
+	 *        queue of the IRC context is full.
+	 *
+	 * Called whenever the event queue reaches one of its water marks (see
+	 * irc::set_event_queue_watermarks()).
+	 */
+	void update_recv_pause();
+
+	/**
+	 * \brief Schedules the next reconnect attempt, if the policy allows one.
+	 *
+	 * \param api_mutex_lock A reference to the lock currently holding
+	 *                       api_mutex.
+	 */
+	void schedule_reconnect(boost::mutex::scoped_lock &api_mutex_lock);
+
+	/**
+	 * \brief Splits received data into lines and queues them as events.
+	 *
+	 * Queues a raw_irc_line_event for every complete, non-empty line, all
+	 * at once. Lines longer than helper::line_framer::default_max_line_length
+	 * are dropped.
+	 *
+	 * \param data A pointer to the received data.
+	 * \param length The number of bytes available at data.
+	 *
+	 * \return The number of bytes consumed, i.e. the length of all complete
+	 *         lines including their line endings. The remaining data is an
+	 *         incomplete line and has to be passed again once more data is
+	 *         available.
+	 */
+	std::size_t frame_lines(const char *data, std::size_t length);
+
+	boost::asio::io_service &io; ///< \brief The io_service running the connection.
+
+	mutable boost::mutex api_mutex; ///< \brief Mutex guarding conn, connstat, reconnect and the current server.
+		std::shared_ptr<network::connection> conn; ///< \brief The network::connection, if one is established.
 		connection_status connstat; ///< \brief The current status of the connection.
-		std::string read_buffer; ///< \brief The raw data which has been read, but not emitted as an event yet.
+		struct reconnect_state;
+		std::shared_ptr<reconnect_state> reconnect; ///< \brief The reconnect policy and its current state.
+		std::string hostname; ///< \brief The hostname of the server currently in use.
+		unsigned port; ///< \brief The port of the server currently in use.
+		std::size_t send_high_water; ///< \brief The high water mark passed to new connections.
+		std::size_t send_low_water; ///< \brief The low water mark passed to new connections.
+		std::string capture_path; ///< \brief The file recording the traffic of new connections, if any.
+
+	/**
+	 * \brief The network::connection while it is connected, null otherwise.
+	 *
+	 * Pinned by send(), so it neither needs to lock api_mutex nor to copy a
+	 * shared_ptr. Reset under api_mutex before conn may be replaced.
+	 */
+	helper::pinned_pointer<network::connection> send_target;
+
+	struct flood_state;
+	std::shared_ptr<flood_state> flood; ///< \brief The flood policy, the token bucket and the queued lines; guarded by its own mutex.
+
+	helper::line_framer framer; ///< \brief Splits the received data into lines; only used by frame_lines().
+	std::vector<event::pointer> line_batch; ///< \brief The events of the lines framed by one call of frame_lines().
+
+	boost::mutex recv_pause_mutex; ///< \brief Serializes update_recv_pause().
 
-	std::string hostname; ///< \brief The hostname from the connection string.
-	unsigned port; ///< \brief The port from the connection string.
+	boost::signals2::scoped_connection event_queue_full_connection; ///< \brief Pauses receiving when the event queue is full.
+	boost::signals2::scoped_connection event_queue_drained_connection; ///< \brief Resumes receiving when the event queue is drained.
 };
 
 }
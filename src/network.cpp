@@ -26,73 +26,156 @@
 #include <algorithm>
 #include <atomic>
 #include <stdexcept>
+#include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 
+#include <boost/asio/steady_timer.hpp>
+
+#include "network/poll_descriptor.hpp"
+#include "network/resolver_cache.hpp"
+#include "network/uring_service.hpp"
+
 namespace {
 	boost::asio::io_service network_service;
-	boost::thread network_service_async_worker;
+	std::vector<boost::thread> network_service_async_workers;
 	std::unique_ptr<boost::asio::io_service::work> work_loop;
 
 	boost::mutex network_external_api;
 		bool automatic_handling;
+		unsigned worker_thread_count = 1;
 
-	void do_stop_thread() {
+	std::atomic<slirc::network::io_backend> selected_io_backend(slirc::network::io_backend::reactor);
+
+	void do_stop_threads() {
 		network_service.stop();
 		work_loop.reset();
 
-		try {
-			// May not be called from within the network thread!
-			// join() terminates otherwise, so at least it is noticable
-			network_service_async_worker.join();
-		}
-		catch(std::invalid_argument &) {
-			// thread was not joinable, i.e. is not running anyway:
-			// everything is fine!
+		for(boost::thread &worker: network_service_async_workers) {
+			try {
+				// May not be called from within a network thread!
+				// join() terminates otherwise, so at least it is noticable
+				worker.join();
+			}
+			catch(std::invalid_argument &) {
+				// thread was not joinable, i.e. is not running anyway:
+				// everything is fine!
+			}
 		}
+		network_service_async_workers.clear();
 	}
 
-	void do_start_thread() {
+	void do_start_threads() {
 		if (!network_service.stopped()) {
 			// service is still running - we got nothing to do here
 			return;
 		}
 
-		// service is not running - but let's try to clean up an old thread
-		do_stop_thread();
-		// thread is now joined
-
-		// Prepare atomic flag to check for correct thread startup
-		std::atomic_flag thread_is_starting;
-		thread_is_starting.test_and_set();
-		// thread_is_starting is now true
+		// service is not running - but let's try to clean up old threads
+		do_stop_threads();
+		// threads are now joined
 
+		// No worker is running, so the service can safely be reset from here.
+		// It will no longer register as stopped() once this returns, so there
+		// is no need to wait for the workers to start up.
+		network_service.reset();
 		work_loop.reset(new boost::asio::io_service::work(network_service));
 
-		boost::thread newthread([&](){
-			network_service.reset();
-			thread_is_starting.clear();
-			network_service.run();
-		});
-
-		while(thread_is_starting.test_and_set()) {
-			// will only turn false *one time* after the new thread has
-			// passed reset() (and thus network_service will no longer
-			// register as stopped())
-			boost::thread::yield(); // wait for it ... just wait for it ...
+		network_service_async_workers.reserve(worker_thread_count);
+		for(unsigned i=0; i<worker_thread_count; ++i) {
+			network_service_async_workers.emplace_back([](){
+				network_service.run();
+			});
 		}
+	}
+}
 
-		std::swap(newthread, network_service_async_worker);
+namespace {
+	// checks whether manual processing is allowed and prepares for it
+	bool begin_manual_run() {
+		boost::lock_guard<boost::mutex> extapi_lock(network_external_api);
+		if (automatic_handling) {
+			return false;
+		}
+		slirc::network::detail::poll_descriptor::instance().drain();
+		return true;
 	}
 }
 
 void slirc::network::run() {
-	boost::lock_guard<boost::mutex> extapi_lock(network_external_api);
-	if (automatic_handling) {
+	if (!begin_manual_run()) {
 		return;
 	}
-	service.poll();
+	network_service.poll();
+}
+
+std::size_t slirc::network::run_one() {
+	if (!begin_manual_run()) {
+		return 0;
+	}
+	const std::size_t handlers = network_service.run_one();
+	if (handlers) {
+		// there may be more ready handlers
+		slirc::network::detail::poll_descriptor::instance().notify(network_service);
+	}
+	return handlers;
+}
+
+std::size_t slirc::network::run_for(std::chrono::steady_clock::duration timeout) {
+	if (!begin_manual_run()) {
+		return 0;
+	}
+
+	// The deadline handler may outlive this call if the service is stopped,
+	// so it must not refer to the stack.
+	std::shared_ptr<bool> expired = std::make_shared<bool>(false);
+	boost::asio::steady_timer deadline(network_service, timeout);
+	deadline.async_wait([expired](const boost::system::error_code &) {
+		*expired = true;
+	});
+
+	std::size_t handlers = 0;
+	while(!*expired && network_service.run_one()) {
+		++handlers;
+	}
+	if (!*expired) {
+		// Stopped early. Consume the cancelled deadline here while the
+		// service can still run it, so it does not show up as a handler of
+		// a later run.
+		deadline.cancel();
+		while(!*expired && network_service.poll_one()) {
+			++handlers;
+		}
+	}
+	else {
+		// there may be more ready handlers
+		slirc::network::detail::poll_descriptor::instance().notify(network_service);
+	}
+	if (*expired) {
+		--handlers; // the deadline itself does not count
+	}
+	return handlers;
+}
+
+std::size_t slirc::network::poll(std::size_t max_handlers) {
+	if (!begin_manual_run()) {
+		return 0;
+	}
+
+	std::size_t handlers = 0;
+	while(handlers < max_handlers && network_service.poll_one()) {
+		++handlers;
+	}
+	if (handlers == max_handlers) {
+		// there may be more ready handlers
+		slirc::network::detail::poll_descriptor::instance().notify(network_service);
+	}
+	return handlers;
+}
+
+int slirc::network::poll_descriptor() {
+	return detail::poll_descriptor::instance().native_handle();
 }
 
 void slirc::network::set_handling_mode(slirc::network::handling_mode mode) {
@@ -104,10 +187,12 @@ void slirc::network::set_handling_mode(slirc::network::handling_mode mode) {
 	if (current_mode != mode) {
 		if (mode == handling_mode::automatic) {
 			network_service.stop();
-			do_start_thread();
+			do_start_threads();
 		}
 		else {
-			do_stop_thread();
+			do_stop_threads();
+			// allow run() and friends to process the service manually
+			network_service.reset();
 		}
 
 		// safe to do: guarded by network_external_api mutex
@@ -115,6 +200,52 @@ void slirc::network::set_handling_mode(slirc::network::handling_mode mode) {
 	}
 }
 
+void slirc::network::set_worker_threads(unsigned count) {
+	if (!count) {
+		count = std::max(1u, boost::thread::hardware_concurrency());
+	}
+
+	boost::lock_guard<boost::mutex> extapi_lock(network_external_api);
+	if (count != worker_thread_count) {
+		worker_thread_count = count;
+
+		if (automatic_handling) {
+			// restart the pool with the new number of workers
+			do_stop_threads();
+			do_start_threads();
+		}
+	}
+}
+
+unsigned slirc::network::worker_threads() {
+	boost::lock_guard<boost::mutex> extapi_lock(network_external_api);
+	return worker_thread_count;
+}
+
+void slirc::network::set_resolver_cache_ttl(std::chrono::seconds positive, std::chrono::seconds negative) {
+	detail::resolver_cache::instance().set_ttl(positive, negative);
+}
+
+void slirc::network::clear_resolver_cache() {
+	detail::resolver_cache::instance().clear();
+}
+
+bool slirc::network::set_io_backend(io_backend backend) {
+#ifdef LIBSLIRC_OPTION_WITH_IO_URING
+	const bool available = backend != io_backend::io_uring || detail::uring_service::supported();
+#else
+	const bool available = backend != io_backend::io_uring;
+#endif
+	if (available) {
+		selected_io_backend = backend;
+	}
+	return available;
+}
+
+slirc::network::io_backend slirc::network::current_io_backend() {
+	return selected_io_backend;
+}
+
 slirc::network::handling_mode slirc::network::current_handling_mode() {
 	boost::lock_guard<boost::mutex> extapi_lock(network_external_api);
 	return automatic_handling
@@ -23,6 +23,9 @@
 #ifndef LIBSLIRC_HDR_NETWORK_HPP_INCLUDED
 #define LIBSLIRC_HDR_NETWORK_HPP_INCLUDED
 
+#include <chrono>
+#include <cstddef>
+
 namespace boost { namespace asio {
 	struct io_service;
 }}
@@ -39,6 +42,14 @@ enum class handling_mode {
 	manual ///< network i/o processing has to be manually invoked by the user
 };
 
+/**
+ * \brief Enumeration for the ways connections receive data.
+ */
+enum class io_backend {
+	reactor, ///< sockets are read by the reactor of the io_service (default)
+	io_uring ///< sockets are read by multishot receives of a Linux io_uring
+};
+
 /**
  * \brief Manually run network tasks.
  *
@@ -47,13 +58,76 @@ enum class handling_mode {
  */
 void run();
 
+/**
+ * \brief Manually runs network tasks until one handler has been run.
+ *
+ * Blocks until a network task is available, unless there is no network
+ * activity going on at all.
+ *
+ * \return The number of handlers run (0 or 1).
+ *
+ * \note This request will be ignored if the handling mode is currently set to
+ *       handling_mode::automatic.
+ */
+std::size_t run_one();
+
+/**
+ * \brief Manually runs network tasks for a limited time.
+ *
+ * \param timeout The time after which to stop running tasks.
+ *
+ * \return The number of handlers run.
+ *
+ * \note This request will be ignored if the handling mode is currently set to
+ *       handling_mode::automatic.
+ */
+std::size_t run_for(std::chrono::steady_clock::duration timeout);
+
+/**
+ * \brief Manually runs a limited number of ready network tasks.
+ *
+ * Does not block.
+ *
+ * \param max_handlers The maximum number of handlers to run.
+ *
+ * \return The number of handlers run.
+ *
+ * \note This request will be ignored if the handling mode is currently set to
+ *       handling_mode::automatic.
+ */
+std::size_t poll(std::size_t max_handlers);
+
+/**
+ * \brief Returns a descriptor to integrate the network into an event loop.
+ *
+ * The descriptor becomes readable when there is socket activity to process,
+ * when connections have been given work (e.g. data to send) and when a
+ * run_one(), poll() or run_for() call left ready handlers behind. Add it to
+ * your own event loop (e.g. epoll) and call run(), poll() or run_for() when
+ * it becomes readable.
+ *
+ * \return The descriptor, or -1 if the platform does not support it.
+ *
+ * \note Expiring timers (e.g. reconnect delays) and completed host name
+ *       resolutions do not make the descriptor readable. If you rely on
+ *       them, also process the network regularly, e.g. by limiting the wait
+ *       of your event loop to a few hundred milliseconds.
+ *
+ * \note Connections and listeners run by an application supplied io_service
+ *       are not covered, as the functions above do not run it.
+ *
+ * \note The descriptor is only useful in handling_mode::manual.
+ */
+int poll_descriptor();
+
 /**
  * \brief Sets whether network should be handled manually or automatically.
  *
  * \param mode Set to handling_mode::manual to handle the network yourself.
  *             Network events are only handled when you call run() manually.
  *             Set to handling_mode::automatic (default) to have libslirc
- *             handle the network in a separate thread.
+ *             handle the network in separate threads (see
+ *             set_worker_threads()).
  *
  * \note May not be called from within the internal network thread.
  */
@@ -70,8 +144,82 @@ void set_handling_mode(handling_mode mode = handling_mode::manual);
  */
 handling_mode current_handling_mode();
 
+/**
+ * \brief Sets the number of threads handling the network in automatic mode.
+ *
+ * All worker threads run the same io_service. Every connection serializes its
+ * own handlers, so different connections can be handled concurrently while
+ * the handlers of a single connection are never run in parallel.
+ *
+ * \param count The number of worker threads to use. If set to 0 (default),
+ *              one thread per hardware thread will be used.
+ *
+ * \note If networking is currently handled automatically, the worker threads
+ *       are restarted with the new number of threads.
+ *
+ * \note May not be called from within the internal network thread.
+ */
+void set_worker_threads(unsigned count = 0);
+
+/**
+ * \brief Returns the number of threads used in automatic handling mode.
+ *
+ * \return The number of worker threads.
+ */
+unsigned worker_threads();
+
+/**
+ * \brief Sets how long host name resolutions are cached.
+ *
+ * All connections share a cache of resolved host names. Connections resolving
+ * the same host name at the same time share a single query.
+ *
+ * \param positive How long successful resolutions are kept. Defaults to 60
+ *                 seconds.
+ * \param negative How long failed resolutions are kept. Defaults to 5
+ *                 seconds.
+ *
+ * \note Set both to 0 to disable caching. Concurrent resolutions will still
+ *       share a single query.
+ */
+void set_resolver_cache_ttl(std::chrono::seconds positive, std::chrono::seconds negative);
+
+/**
+ * \brief Drops all cached host name resolutions.
+ */
+void clear_resolver_cache();
+
+/**
+ * \brief Selects how connections receive data.
+ *
+ * With io_backend::io_uring, every io_service gets an io_uring, and each
+ * connection submits a single multishot receive into buffers registered with
+ * the kernel instead of one receive per read. This saves a system call and
+ * usually a wakeup per read on hosts with many busy connections.
+ *
+ * Connections use the backend selected at the time they are established.
+ * SSL connections, and connections whose io_service failed to set up a ring,
+ * always use the reactor.
+ *
+ * \param backend The backend to use for connections established from now on.
+ *
+ * \return true if the backend is used from now on, false if it is not
+ *         available. The io_uring backend requires Linux 6.0 or newer and
+ *         libslirc to be compiled with LIBSLIRC_OPTION_WITH_IO_URING.
+ */
+bool set_io_backend(io_backend backend);
+
+/**
+ * \brief Returns the backend used for connections established from now on.
+ */
+io_backend current_io_backend();
+
 /**
  * \brief A reference to internally used the Boost.ASIO io_service object.
+ *
+ * Connections and listeners constructed with an application supplied
+ * io_service do not use this one. The run functions, the handling mode, the
+ * worker threads and poll_descriptor() only concern this io_service.
  */
 extern boost::asio::io_service &service;
 
@@ -0,0 +1,111 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#include "capture_writer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/thread/locks.hpp>
+
+namespace {
+	// stores value at out in little endian byte order
+	template <typename T>
+	void store_le(char *out, T value) {
+		for(std::size_t i=0; i<sizeof(T); ++i) {
+			out[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+		}
+	}
+}
+
+const char slirc::network::detail::capture_writer::magic[8] = {
+	'S', 'L', 'I', 'R', 'C', 'C', 'P', '1'
+};
+
+slirc::network::detail::capture_writer::capture_writer(boost::asio::io_service &service, const std::string &path)
+: io(service)
+, start(std::chrono::steady_clock::now())
+, out(path.c_str(), std::ios::binary | std::ios::trunc) {
+	if (!out) {
+		throw std::runtime_error("Cannot open capture file " + path);
+	}
+	out.write(magic, sizeof(magic));
+}
+
+slirc::network::detail::capture_writer::~capture_writer() {
+	// Nobody else is left, so there is no need to lock.
+	for(const std::vector<char> &records: queue) {
+		out.write(records.data(), records.size());
+	}
+	out.write(collected.data(), collected.size());
+}
+
+void slirc::network::detail::capture_writer::write(direction_type direction, const char *data, std::size_t length) {
+	while (length) {
+		// records are limited to 4 GiB; split larger chunks
+		const std::size_t record_length = std::min<std::size_t>(length, std::numeric_limits<std::uint32_t>::max());
+
+		char header[record_header_size];
+		store_le<std::uint64_t>(header, std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count());
+		header[8] = static_cast<char>(direction);
+		store_le<std::uint32_t>(header + 9, static_cast<std::uint32_t>(record_length));
+		collected.insert(collected.end(), header, header + sizeof(header));
+		collected.insert(collected.end(), data, data + record_length);
+
+		data += record_length;
+		length -= record_length;
+	}
+
+	if (collected.size() >= flush_size) {
+		flush();
+	}
+}
+
+void slirc::network::detail::capture_writer::flush() {
+	if (collected.empty()) {
+		return;
+	}
+	{ boost::lock_guard<boost::mutex> lock(queue_mutex);
+		queue.push_back(std::move(collected));
+	}
+	collected = std::vector<char>();
+	collected.reserve(flush_size);
+
+	std::shared_ptr<capture_writer> self = shared_from_this();
+	io.post([self]() {
+		self->write_out();
+	});
+}
+
+void slirc::network::detail::capture_writer::write_out() {
+	boost::lock_guard<boost::mutex> file_lock(file_mutex);
+	std::deque<std::vector<char>> records;
+	{ boost::lock_guard<boost::mutex> lock(queue_mutex);
+		records.swap(queue);
+	}
+	for(const std::vector<char> &chunk: records) {
+		out.write(chunk.data(), chunk.size());
+	}
+}
@@ -0,0 +1,122 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_NETWORK_CAPTURE_WRITER_HPP_INCLUDED
+#define LIBSLIRC_HDR_NETWORK_CAPTURE_WRITER_HPP_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace slirc {
+namespace network {
+namespace detail {
+	/**
+	 * \brief Records the traffic of a connection to a file.
+	 *
+	 * The file starts with the 8 bytes of magic, followed by records of:
+	 * - the time since the capture was started in nanoseconds (8 bytes)
+	 * - the direction, see direction_type (1 byte)
+	 * - the length of the data (4 bytes)
+	 * - the data itself
+	 *
+	 * All numbers are in little endian byte order.
+	 *
+	 * Records are collected in memory by the connection's strand and written
+	 * by a handler posted to the io_service, so the strand never blocks on
+	 * the file. The rest is written when the writer is destroyed.
+	 */
+	struct capture_writer: std::enable_shared_from_this<capture_writer>, private boost::noncopyable {
+		/**
+		 * \brief The direction of a record.
+		 */
+		enum direction_type: std::uint8_t {
+			received = 0, ///< Data received from the remote side.
+			sent = 1 ///< Data sent to the remote side.
+		};
+
+		/// \brief The first bytes of every capture file.
+		static const char magic[8];
+		/// \brief The size of the header preceding the data of a record.
+		static const std::size_t record_header_size = 13;
+
+		/// \brief The amount of records collected before they are written.
+		static const std::size_t flush_size = 64 * 1024;
+
+		/**
+		 * \brief Creates (or truncates) the capture file.
+		 *
+		 * \param service The io_service to write the file on.
+		 * \param path The file to write to.
+		 *
+		 * \throw std::runtime_error if the file cannot be opened.
+		 */
+		capture_writer(boost::asio::io_service &service, const std::string &path);
+
+		/**
+		 * \brief Writes the records not written yet.
+		 */
+		~capture_writer();
+
+		/**
+		 * \brief Appends a record.
+		 *
+		 * Must not be called concurrently, i.e. only from a single strand.
+		 */
+		void write(direction_type direction, const char *data, std::size_t length);
+
+		/**
+		 * \brief Hands the records collected so far over to be written.
+		 *
+		 * Must not be called concurrently with write().
+		 */
+		void flush();
+
+	private:
+		// writes the records handed over so far
+		void write_out();
+
+		boost::asio::io_service &io;
+		std::chrono::steady_clock::time_point start;
+		std::vector<char> collected; // records not handed over yet
+
+		boost::mutex queue_mutex;
+			std::deque<std::vector<char>> queue; // records handed over
+
+		// held while writing, so the queue is written in order
+		boost::mutex file_mutex;
+			std::ofstream out;
+	};
+}
+}
+}
+
+#endif // LIBSLIRC_HDR_NETWORK_CAPTURE_WRITER_HPP_INCLUDED
@@ -20,252 +20,90 @@
 **  If not, see <http://www.gnu.org/licenses/>.                           **
 ***************************************************************************/
 
-// Careful! This file is ugly!
-
 #include "connection.hpp"
 
-#include <cassert>
-
-#include <boost/asio.hpp>
-#include <boost/thread.hpp>
-
-#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
-#	include <boost/asio/ssl.hpp>
-#endif
-
-#include "../network.hpp"
-
-namespace slirc {
-namespace network {
-namespace detail {
-	using boost::asio::ip::tcp;
-	namespace ssl = boost::asio::ssl;
-
-	struct connection_implementation {
-		static const size_t arbitrary_buffer_length = 512;
-
-		static inline boost::asio::io_service &service() {
-			return network::service;
-		}
-
-		struct resolver {
-			resolver()
-			: res(service())
-			{}
-
-			tcp::resolver res;
-			tcp::resolver::iterator it;
-		};
-		char recv_buffer[arbitrary_buffer_length];
-		std::unique_ptr<resolver> resolver_context;
-		boost::mutex socket_mutex;
-			std::unique_ptr<tcp::socket> socket;
-			bool send_in_progress;
-			std::string send_buffer;
-#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
-			std::unique_ptr<ssl::stream<tcp::socket>> ssl_stream;
-			const ssl::context *ssl_context;
-#endif
-
-		slirc::network::connection::status_handler_type status_handler;
-		slirc::network::connection::recv_handler_type   recv_handler;
-		slirc::network::connection::send_handler_type  send_handler;
-
-		connection_implementation()
-		: send_in_progress(false)
-		, status_handler([](const boost::system::error_code &){})
-		, recv_handler([](const std::string &){})
-		, send_handler([](std::size_t){})
-		, recv_buffer()
-#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
-		, ssl_context(nullptr)
-#endif
-		{}
-
-		~connection_implementation() {
-			if (
-				// Careful! disconnect() locks itself, so ONLY protect the
-				// condition of the if.
-				boost::lock_guard<boost::mutex>(socket_mutex),
-				socket && socket->is_open()
-			) {
-				disconnect();
-			}
-		}
-
-		void connect(const std::string &addr, const std::string &service_port) {
-			resolver_context.reset(new resolver());
-			resolver_context->res.async_resolve(
-				tcp::resolver::query(addr, service_port),
-				[&](const boost::system::error_code& error, tcp::resolver::iterator it) {
-					if (!error) {
-						resolver_context->it = it;
-						boost::lock_guard<boost::mutex> socket_lock(socket_mutex);
-						assert(!socket);
-						socket.reset(new tcp::socket(service()));
-#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
-						if (ssl_context) {
-							ssl_stream.reset(new ssl::stream<tcp::socket>(*socket, *ssl_context));
-						}
-#endif
-						try_connect(socket_lock);
-					}
-					else {
-						status_handler(error);
-					}
-				}
-			);
-		}
-
-		void accept(unsigned port) {
-			boost::lock_guard<boost::mutex> socket_lock(socket_mutex);
-			assert(!socket);
-
-			// TODO
-			static_cast<void>(port);
-		}
+#include "connection_implementation.hpp"
 
-		void disconnect() {
-			boost::lock_guard<boost::mutex> socket_lock(socket_mutex);
-			assert(socket);
-			boost::system::error_code ignored_error;
-			socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_error);
-			socket->close(ignored_error);
-		}
-
-		void send(const std::string &data) {
-			boost::lock_guard<boost::mutex> socket_lock(socket_mutex);
-			assert(socket);
-			send_buffer += data;
-			if (!send_in_progress) {
-				send_in_progress = true;
-				try_send(socket_lock);
-			}
-		}
+slirc::network::connection::connection()
+: impl(std::make_shared<slirc::network::detail::connection_implementation>(network::service)) {}
 
-	private:
-		// attempts to send more data
-		void try_send(boost::lock_guard<boost::mutex> &socket_lock_unused) {
-			assert(socket);
-			// assumes socket_mutex to be locked by the current thread
-			static_cast<void>(socket_lock_unused); // just passed to reinforce
-			// the caller to lock the mutex before calling this function
+slirc::network::connection::connection(boost::asio::io_service &service)
+: impl(std::make_shared<slirc::network::detail::connection_implementation>(service)) {}
 
-			if (send_buffer.empty()) {
-				send_in_progress = false;
-				return; // nothing to do
-			}
+slirc::network::connection::~connection() {
+	// The implementation lives on until its pending handlers have completed,
+	// but they must not call back into the application anymore.
+	impl->orphan();
+}
 
-			auto handler = [&](
-				const boost::system::error_code& error, // Result of operation.
-				std::size_t bytes_transferred
-			) {
-				if (bytes_transferred) {
-					send_handler(bytes_transferred);
-					boost::lock_guard<boost::mutex> socket_lock(socket_mutex);
-					send_buffer.erase(0, bytes_transferred);
-				}
-				if (error) {
-					status_handler(error);
-				}
-				else {
-					boost::lock_guard<boost::mutex> socket_lock(socket_mutex);
-					try_send(socket_lock);
-				}
-			};
+void slirc::network::connection::on_status(status_handler_type status_handler) {
+	impl->status_handler = status_handler;
+}
 
-#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
-			if (ssl_stream)
-				boost::asio::async_write(*ssl_stream, boost::asio::buffer(send_buffer), handler);
-			else
-#endif
-				boost::asio::async_write(*socket, boost::asio::buffer(send_buffer), handler);
-		}
+void slirc::network::connection::on_recv(recv_handler_type recv_handler) {
+	impl->recv_handler = [recv_handler](const char *data, std::size_t length) {
+		recv_handler(std::string(data, length));
+		return length;
+	};
+}
 
-		// attempts a connection to the next endpoint
-		void try_connect(boost::lock_guard<boost::mutex> &socket_lock_unused) {
-			assert(socket);
-			// assumes socket_mutex to be locked by the current thread
-			static_cast<void>(socket_lock_unused); // just passed to reinforce
-			// the caller to lock the mutex before calling this function
+void slirc::network::connection::on_recv_view(recv_view_handler_type recv_handler) {
+	impl->recv_handler = recv_handler;
+}
 
-			static const tcp::resolver::iterator end;
-			assert(resolver_context->it != end);
+void slirc::network::connection::on_send(send_handler_type send_handler) {
+	impl->send_handler = send_handler;
+}
 
-			tcp::resolver::iterator current = resolver_context->it++;
+void slirc::network::connection::on_send_pressure(send_pressure_handler_type send_pressure_handler) {
+	impl->send_pressure_handler = send_pressure_handler;
+}
 
-			socket->async_connect(
-				*current,
-				[&](const boost::system::error_code &error) {
-					static const tcp::resolver::iterator end;
-					if (error && end != ++(resolver_context->it)) {
-						boost::lock_guard<boost::mutex> socket_lock(socket_mutex);
-						try_connect(socket_lock);
-					}
-					else {
-						// connection succeeded or
-						// last endpoint failed connecting
-						status_handler(error);
-						if (!error) {
-							// It actually succeeded! - start recving here.
-							boost::lock_guard<boost::mutex> socket_lock(socket_mutex);
-							try_recv(socket_lock);
-						}
-					}
-				}
-			);
-		}
+void slirc::network::connection::set_send_watermarks(std::size_t high_water, std::size_t low_water) {
+	impl->set_send_watermarks(high_water, low_water);
+}
 
-		// attempts recving from the socket
-		void try_recv(boost::lock_guard<boost::mutex> &socket_lock_unused) {
-			assert(socket);
-			// assumes socket_mutex to be locked by the current thread
-			static_cast<void>(socket_lock_unused); // just passed to reinforce
-			// the caller to lock the mutex before calling this function
+std::size_t slirc::network::connection::send_queue_size() const {
+	return impl->send_queue_bytes;
+}
 
-			if (socket) { // nowhere to recv from otherwise
-				auto buffer = boost::asio::buffer(recv_buffer, arbitrary_buffer_length);
-				auto reader = [&](
-					const boost::system::error_code& error, // Result of operation.
-					std::size_t bytes_transferred           // Number of bytes recv
-				) {
-					if (error) {
-						status_handler(error);
-					}
-					else {
-						recv_handler(std::string(recv_buffer, bytes_transferred));
-						boost::lock_guard<boost::mutex> socket_lock(socket_mutex);
-						try_recv(socket_lock); // and recv some more!
-					}
-				};
+void slirc::network::connection::start_capture(const std::string &path) {
+	// opened right here, so errors are reported to the caller
+	impl->set_capture(std::make_shared<detail::capture_writer>(impl->service(), path));
+}
 
-#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
-				if (ssl_stream)
-					ssl_stream->async_receive(buffer, reader);
-				else
-#endif
-					socket->async_receive(buffer, reader);
-			}
-		}
-	};
+void slirc::network::connection::stop_capture() {
+	impl->set_capture(nullptr);
 }
+
+void slirc::network::connection::pause_recv() {
+	impl->pause_recv();
 }
+
+void slirc::network::connection::resume_recv() {
+	impl->resume_recv();
 }
 
-slirc::network::connection::connection()
-: impl(new slirc::network::detail::connection_implementation()) {}
+void slirc::network::connection::set_connect_mode(connect_mode mode, std::chrono::milliseconds attempt_delay) {
+	impl->connect_mode = mode;
+	impl->connect_attempt_delay = attempt_delay;
+}
 
-slirc::network::connection::~connection() {
-	// Necessary: Destruction involves destructing the implementation instance,
-	// which is not known to a generated destructor.
+void slirc::network::connection::set_recv_buffer_size(std::size_t size) {
+	impl->set_read_size(size, size);
 }
 
-void slirc::network::connection::on_status(status_handler_type status_handler) {
-	impl->status_handler = status_handler;
+void slirc::network::connection::set_recv_buffer_size(std::size_t min_size, std::size_t max_size) {
+	impl->set_read_size(min_size, max_size);
 }
 
-void slirc::network::connection::on_recv(recv_handler_type recv_handler) {
-	impl->recv_handler = recv_handler;
+slirc::network::connection::recv_statistics slirc::network::connection::recv_stats() const {
+	recv_statistics stats;
+	stats.read_size = impl->read_size;
+	stats.reads = impl->stat_reads;
+	stats.bytes = impl->stat_bytes;
+	stats.full_reads = impl->stat_full_reads;
+	return stats;
 }
 
 void slirc::network::connection::use_ssl(const boost::asio::ssl::context &ssl_context) {
@@ -285,6 +123,14 @@ void slirc::network::connection::no_ssl() {
 }
 
 void slirc::network::connection::send(const std::string &data) {
+	impl->send(helper::make_shared_buffer(data));
+}
+
+void slirc::network::connection::send(std::string &&data) {
+	impl->send(helper::make_shared_buffer(std::move(data)));
+}
+
+void slirc::network::connection::send(const helper::shared_buffer &data) {
 	impl->send(data);
 }
 
@@ -292,6 +138,10 @@ void slirc::network::connection::connect(const std::string &hostname, unsigned p
 	impl->connect(hostname, std::to_string(port));
 }
 
+void slirc::network::connection::accept(unsigned port) {
+	impl->accept(port);
+}
+
 void slirc::network::connection::disconnect() {
 	impl->disconnect();
 }
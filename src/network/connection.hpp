@@ -23,12 +23,17 @@
 #ifndef LIBSLIRC_HDR_NETWORK_CONNECTION_HPP_INCLUDED
 #define LIBSLIRC_HDR_NETWORK_CONNECTION_HPP_INCLUDED
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
 
 #include <boost/noncopyable.hpp>
 
+#include "../helper/shared_buffer.hpp"
+#include "../network.hpp"
+
 namespace boost { namespace asio { namespace ssl {
 	struct context;
 }}}
@@ -41,6 +46,7 @@ namespace network {
 
 namespace detail {
 	struct connection_implementation;
+	struct listener_implementation;
 }
 
 /**
@@ -49,6 +55,13 @@ namespace detail {
  * Use this class to set up handlers for a connection before either
  * establishing a connection to a remote server using connect() or accepting a
  * connection from a remote client using accept().
+ *
+ * The handlers of a single connection are never invoked concurrently, even if
+ * the network is handled by multiple worker threads. No handler is invoked
+ * anymore once the connection has been destroyed.
+ *
+ * send() and disconnect() may be called from any thread at any time; neither
+ * of them blocks.
  */
 struct connection: private boost::noncopyable {
 	/**
@@ -65,6 +78,16 @@ struct connection: private boost::noncopyable {
 		void(const std::string &)
 	> recv_handler_type;
 
+	/**
+	 * \brief Callback type for in-place recv handlers.
+	 *
+	 * The handler is passed a pointer to and the length of all data received
+	 * but not consumed yet and returns the number of bytes it has consumed.
+	 */
+	typedef std::function<
+		std::size_t(const char *, std::size_t)
+	> recv_view_handler_type;
+
 	/**
 	 * \brief Callback type for send handlers.
 	 */
@@ -72,11 +95,55 @@ struct connection: private boost::noncopyable {
 		void(std::size_t)
 	> send_handler_type;
 
+	/**
+	 * \brief Callback type for send pressure handlers.
+	 *
+	 * Called with true once the data waiting to be sent reaches the high
+	 * water mark, and with false once it has been drained to the low water
+	 * mark.
+	 */
+	typedef std::function<
+		void(bool)
+	> send_pressure_handler_type;
+
+	/**
+	 * \brief How to try the addresses a host name resolves to.
+	 */
+	enum class connect_mode {
+		sequential, ///< Try one address after another (default).
+		parallel ///< Try addresses in parallel, staggered by a short delay (RFC 8305).
+	};
+
+	/**
+	 * \brief Statistics about the data received on a connection.
+	 */
+	struct recv_statistics {
+		std::size_t read_size; ///< The number of bytes currently requested per read.
+		std::uint64_t reads; ///< The number of completed reads.
+		std::uint64_t bytes; ///< The total number of bytes received.
+		std::uint64_t full_reads; ///< The number of reads that filled the requested size.
+	};
+
 	/**
 	 * \brief Constructs a connection.
+	 *
+	 * The connection is run by libslirc's own io_service (network::service).
 	 */
 	connection();
 
+	/**
+	 * \brief Constructs a connection run by an application supplied
+	 *        io_service.
+	 *
+	 * All handlers of this connection will be invoked by the threads running
+	 * the given io_service. The handling mode and worker threads of libslirc
+	 * do not affect the connection.
+	 *
+	 * \param service The io_service to run the connection on. It has to
+	 *                outlive the connection.
+	 */
+	explicit connection(boost::asio::io_service &service);
+
 	/**
 	 * \brief Destructs a connection.
 	 */
@@ -117,6 +184,28 @@ struct connection: private boost::noncopyable {
 	 */
 	void on_recv(recv_handler_type recv_handler);
 
+	/**
+	 * \brief Sets up a handler to process incoming data in place.
+	 *
+	 * The handler will be called whenever data is received on the socket. It
+	 * is passed a view into the internal receive buffer, which is only valid
+	 * for the duration of the call, and returns how many bytes it has
+	 * consumed from the front of it. Unconsumed data will be passed again,
+	 * followed by the newly received data, on the next call.
+	 *
+	 * Unlike on_recv(), this avoids copying the received data.
+	 *
+	 * \param recv_handler The recv handler callback to be set. Replaces a
+	 *                     handler set by on_recv().
+	 *
+	 * \note The handler passed may be called from a different thread. Make
+	 *       sure to properly synchronize its implementation.
+	 *
+	 * \note This function should only be called before calling connect()
+	 *       or accept()
+	 */
+	void on_recv_view(recv_view_handler_type recv_handler);
+
 	/**
 	 * \brief Sets up a handler to confirm send status.
 	 *
@@ -132,11 +221,138 @@ struct connection: private boost::noncopyable {
 	 */
 	void on_send(send_handler_type send_handler);
 
+	/**
+	 * \brief Sets up a handler to be told when data piles up to be sent.
+	 *
+	 * \param send_pressure_handler The send pressure handler callback to be
+	 *                              set.
+	 *
+	 * \note The handler passed may be called from a different thread. Make
+	 *       sure to properly synchronize its implementation.
+	 *
+	 * \note This function should only be called before calling connect()
+	 *       or accept()
+	 *
+	 * \see set_send_watermarks()
+	 */
+	void on_send_pressure(send_pressure_handler_type send_pressure_handler);
+
+	/**
+	 * \brief Sets the water marks of the data waiting to be sent.
+	 *
+	 * Data is never dropped because of the water marks; they merely tell
+	 * the send pressure handler when to hold back sending more.
+	 *
+	 * \param high_water The number of bytes considered too many, or 0 (the
+	 *                   default) to disable the water marks.
+	 * \param low_water The number of bytes considered few enough again. Must
+	 *                  be less than high_water.
+	 *
+	 * \note This function is thread safe.
+	 */
+	void set_send_watermarks(std::size_t high_water, std::size_t low_water);
+
+	/**
+	 * \brief Returns the number of bytes waiting to be sent.
+	 *
+	 * \note This function is thread safe.
+	 */
+	std::size_t send_queue_size() const;
+
+	/**
+	 * \brief Starts recording all data sent and received to a file.
+	 *
+	 * The file can be read by testing::capture_file, e.g. to replay the
+	 * traffic later. A capture already in progress is ended.
+	 *
+	 * \param path The file to write to. An existing file is overwritten.
+	 *
+	 * \throw std::runtime_error if the file cannot be opened.
+	 *
+	 * \note This function is thread safe.
+	 */
+	void start_capture(const std::string &path);
+
+	/**
+	 * \brief Stops recording data.
+	 *
+	 * \note This function is thread safe.
+	 */
+	void stop_capture();
+
+	/**
+	 * \brief Stops receiving data until resume_recv() is called.
+	 *
+	 * Data already received is still passed to the recv handler; the
+	 * operating system holds back further data, which eventually makes the
+	 * remote side stop sending. The status handler is still called if the
+	 * connection is lost.
+	 *
+	 * \note This function is thread safe.
+	 */
+	void pause_recv();
+
+	/**
+	 * \brief Resumes receiving data after pause_recv().
+	 *
+	 * \note This function is thread safe.
+	 */
+	void resume_recv();
+
+	/**
+	 * \brief Sets how the addresses of a host name are tried when connecting.
+	 *
+	 * In parallel mode, a new attempt is started every attempt_delay (or as
+	 * soon as an attempt fails) without waiting for earlier attempts to time
+	 * out, alternating between IPv6 and IPv4 addresses. The first attempt to
+	 * succeed is used; all others are cancelled.
+	 *
+	 * \param mode The connect mode to use.
+	 * \param attempt_delay The delay between two parallel attempts. Ignored in
+	 *                      sequential mode.
+	 *
+	 * \note This function should only be called before calling connect()
+	 */
+	void set_connect_mode(connect_mode mode, std::chrono::milliseconds attempt_delay = std::chrono::milliseconds(250));
+
+	/**
+	 * \brief Sets a fixed number of bytes to be requested per read.
+	 *
+	 * \param size The number of bytes to read at most per read operation.
+	 *             Must not be 0.
+	 */
+	void set_recv_buffer_size(std::size_t size);
+
+	/**
+	 * \brief Lets the number of bytes requested per read adapt to the traffic.
+	 *
+	 * The read size is doubled whenever a read fills it completely, up to
+	 * max_size, and halved, down to min_size, after a number of reads that
+	 * only used a small fraction of it.
+	 *
+	 * This is the default mode, adapting between 512 bytes and 64 KiB.
+	 *
+	 * \param min_size The smallest (and initial) read size. Must not be 0.
+	 * \param max_size The largest read size. Must not be less than min_size.
+	 */
+	void set_recv_buffer_size(std::size_t min_size, std::size_t max_size);
+
+	/**
+	 * \brief Returns statistics about received data.
+	 *
+	 * \return A snapshot of the receive statistics, including the effective
+	 *         read size.
+	 *
+	 * \note This function is thread safe.
+	 */
+	recv_statistics recv_stats() const;
+
 	/**
 	 * \brief Registers an SSL context to be used by the connection.
 	 *
 	 * Calling this function will set the connection to use SSL with the
-	 * supplied context.
+	 * supplied context. Accepted connections perform the server side of the
+	 * handshake before they are reported as established.
 	 *
 	 * \param ssl_context The SSL context to be used for the connection.
 	 *
@@ -161,11 +377,37 @@ struct connection: private boost::noncopyable {
 	 *
 	 * \param data The data to send.
 	 *
-	 * \note This function should only be called after establishing a
-	 *       connection.
+	 * \note Data sent before the connection has been established is sent
+	 *       once it is. Data sent after the connection has been lost is
+	 *       discarded. This function is thread safe and wait-free.
 	 */
 	void send(const std::string &data);
 
+	/**
+	 * \brief Sends data to the remote side without copying it.
+	 *
+	 * \param data The data to send. Its contents are taken over by the
+	 *             connection.
+	 *
+	 * \note Data sent before the connection has been established is sent
+	 *       once it is. Data sent after the connection has been lost is
+	 *       discarded. This function is thread safe and wait-free.
+	 */
+	void send(std::string &&data);
+
+	/**
+	 * \brief Sends a shared buffer to the remote side without copying it.
+	 *
+	 * The same buffer can be sent over any number of connections.
+	 *
+	 * \param data The data to send. A null buffer is ignored.
+	 *
+	 * \note Data sent before the connection has been established is sent
+	 *       once it is. Data sent after the connection has been lost is
+	 *       discarded. This function is thread safe and wait-free.
+	 */
+	void send(const helper::shared_buffer &data);
+
 	/**
 	 * \brief Establishes a connection to a remote server.
 	 *
@@ -174,13 +416,33 @@ struct connection: private boost::noncopyable {
 	 */
 	void connect(const std::string &hostname, unsigned port);
 
+	/**
+	 * \brief Waits for a single remote client to connect.
+	 *
+	 * Listens on the given port on all interfaces and accepts the first
+	 * incoming connection. The status handler is called once the connection
+	 * has been accepted or listening failed.
+	 *
+	 * \param port The port number to listen on.
+	 *
+	 * \note To accept any number of connections, use a network::listener.
+	 */
+	void accept(unsigned port);
+
 	/**
 	 * \brief Ends the existing connection.
+	 *
+	 * The status handler is called with an error once the connection has
+	 * been closed.
+	 *
+	 * \note This function is thread safe.
 	 */
 	void disconnect();
 
 private:
-	std::unique_ptr<detail::connection_implementation> impl;
+	friend struct detail::listener_implementation;
+
+	std::shared_ptr<detail::connection_implementation> impl;
 };
 
 }
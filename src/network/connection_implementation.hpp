@@ -0,0 +1,959 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+// Careful! This file is ugly!
+
+#ifndef LIBSLIRC_HDR_NETWORK_CONNECTION_IMPLEMENTATION_HPP_INCLUDED
+#define LIBSLIRC_HDR_NETWORK_CONNECTION_IMPLEMENTATION_HPP_INCLUDED
+
+#include "connection.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
+#	include <boost/asio/ssl.hpp>
+#endif
+
+#include "../helper/linear_buffer.hpp"
+#include "../helper/mpsc_queue.hpp"
+#include "../helper/shared_buffer.hpp"
+#include "../network.hpp"
+#include "capture_writer.hpp"
+#include "poll_descriptor.hpp"
+#include "resolver_cache.hpp"
+#include "uring_service.hpp"
+
+namespace slirc {
+namespace network {
+namespace detail {
+	using boost::asio::ip::tcp;
+	namespace ssl = boost::asio::ssl;
+
+#ifdef SO_REUSEPORT
+	typedef boost::asio::detail::socket_option::boolean<
+		SOL_SOCKET, SO_REUSEPORT
+	> reuse_port_option;
+#endif
+
+	// opens acceptor and starts listening; an empty address listens on all
+	// interfaces, preferring a dual stack socket if IPv6 is available
+	inline void open_acceptor(tcp::acceptor &acceptor, const std::string &address, unsigned port, bool reuse_port, boost::system::error_code &error) {
+		tcp::endpoint endpoint(tcp::v6(), port);
+		if (!address.empty()) {
+			endpoint.address(boost::asio::ip::address::from_string(address, error));
+			if (error) return;
+		}
+
+		acceptor.open(endpoint.protocol(), error);
+		if (error && address.empty()) {
+			// no IPv6 support - fall back to IPv4
+			endpoint = tcp::endpoint(tcp::v4(), port);
+			acceptor.open(endpoint.protocol(), error);
+		}
+		if (error) return;
+
+		if (address.empty() && endpoint.protocol() == tcp::v6()) {
+			// accept IPv4 as well; failing to do so is not fatal
+			boost::system::error_code ignored_error;
+			acceptor.set_option(boost::asio::ip::v6_only(false), ignored_error);
+		}
+
+		acceptor.set_option(tcp::acceptor::reuse_address(true), error);
+		if (error) return;
+#ifdef SO_REUSEPORT
+		if (reuse_port) {
+			acceptor.set_option(reuse_port_option(true), error);
+			if (error) return;
+		}
+#else
+		static_cast<void>(reuse_port);
+#endif
+
+		acceptor.bind(endpoint, error);
+		if (error) return;
+		acceptor.listen(boost::asio::socket_base::max_connections, error);
+	}
+
+	// All state that is not atomic is owned by the strand: it is only ever
+	// touched by handlers running in the strand, or before the first handler
+	// has been started. Public entry points that need to change it post to the
+	// strand, so no locks are required. Every handler keeps the
+	// implementation alive, so it may outlive the connection object.
+	struct connection_implementation: std::enable_shared_from_this<connection_implementation> {
+		static const size_t default_min_read_size = 512;
+		static const size_t default_max_read_size = 64 * 1024;
+		// number of consecutive small reads before the read size is reduced
+		static const unsigned shrink_after_small_reads = 8;
+		// maximum number of chunks written by a single gathered write; asio
+		// does not pass more than this to a single writev() anyway
+		static const size_t max_gathered_chunks = 64;
+
+		typedef helper::shared_buffer send_chunk;
+
+		// lifecycle of the socket
+		enum class socket_state {
+			idle,       // neither connect() nor accept() has been called yet
+			connecting, // resolving, connecting or accepting
+			connected,  // data can be sent and received
+			closed      // disconnected or failed; queued data is dropped
+		};
+
+		// the io_service all I/O of this connection is run on
+		boost::asio::io_service &io;
+
+		inline boost::asio::io_service &service() const {
+			return io;
+		}
+
+		struct resolver {
+			tcp::resolver::iterator it;
+		};
+
+		// state of parallel connection attempts; shared with the handlers of
+		// all attempts, so the losers can still complete after a new connect
+		struct connect_attempts {
+			connect_attempts(boost::asio::io_service &service)
+			: timer(service)
+			, next(0)
+			, pending(0)
+			, finished(false)
+			{}
+
+			std::vector<tcp::endpoint> endpoints; // in order of attempts
+			std::vector<std::unique_ptr<tcp::socket>> sockets; // one per started attempt
+			boost::asio::steady_timer timer; // delays the next attempt
+			std::size_t next; // index of the next endpoint to attempt
+			std::size_t pending; // number of attempts in progress
+			bool finished; // an attempt has succeeded
+			boost::system::error_code last_error;
+		};
+		connection::connect_mode connect_mode;
+		std::chrono::milliseconds connect_attempt_delay;
+		std::shared_ptr<connect_attempts> attempts;
+		// received data not consumed by the recv handler yet
+		helper::linear_buffer recv_buffer;
+		std::atomic<std::size_t> min_read_size;
+		std::atomic<std::size_t> max_read_size;
+		std::atomic<std::size_t> read_size;
+		unsigned small_reads;
+		std::atomic<std::uint64_t> stat_reads;
+		std::atomic<std::uint64_t> stat_bytes;
+		std::atomic<std::uint64_t> stat_full_reads;
+		std::unique_ptr<resolver> resolver_context;
+		std::unique_ptr<tcp::acceptor> acceptor;
+		// serializes all handlers of this connection, so multiple network
+		// threads never run them concurrently
+		boost::asio::io_service::strand strand;
+		std::unique_ptr<tcp::socket> socket;
+		socket_state state;
+		bool recv_paused; // set by pause_recv()
+		bool recv_stalled; // no receive is in progress because of recv_paused
+		// data waiting to be written; filled by any thread, drained in the
+		// strand
+		helper::mpsc_queue<send_chunk> send_queue;
+		// set while a write is in progress or one has been posted; whoever
+		// sets it is responsible for draining send_queue
+		std::atomic<bool> send_pending;
+		std::vector<send_chunk> send_in_flight; // being written right now
+		std::size_t send_in_flight_bytes;
+		// number of bytes queued or being written
+		std::atomic<std::size_t> send_queue_bytes;
+		std::atomic<std::size_t> send_high_water; // 0 if disabled
+		std::atomic<std::size_t> send_low_water;
+		// whether the high water mark has been reached and the low water
+		// mark not since
+		std::atomic<bool> send_pressure;
+		bool reported_send_pressure; // last value passed to the handler
+		// records the traffic, if set
+		std::shared_ptr<capture_writer> capture;
+		// set once the connection object is gone; no more user handlers are
+		// invoked after that
+		std::atomic<bool> orphaned;
+#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
+		std::unique_ptr<ssl::stream<tcp::socket>> ssl_stream;
+		const ssl::context *ssl_context;
+#endif
+#ifdef LIBSLIRC_OPTION_WITH_IO_URING
+		// the ring receiving for this connection, if any
+		uring_service *uring;
+		std::uint64_t uring_recv; // id of the multishot receive, 0 if none
+#endif
+
+		slirc::network::connection::status_handler_type status_handler;
+		slirc::network::connection::recv_view_handler_type recv_handler;
+		slirc::network::connection::send_handler_type  send_handler;
+		slirc::network::connection::send_pressure_handler_type send_pressure_handler;
+
+		connection_implementation(boost::asio::io_service &service)
+		: io(service)
+		, connect_mode(connection::connect_mode::sequential)
+		, connect_attempt_delay(250)
+		, recv_buffer(4 * default_min_read_size)
+		, min_read_size(default_min_read_size)
+		, max_read_size(default_max_read_size)
+		, read_size(default_min_read_size)
+		, small_reads(0)
+		, stat_reads(0)
+		, stat_bytes(0)
+		, stat_full_reads(0)
+		, strand(service)
+		, state(socket_state::idle)
+		, recv_paused(false)
+		, recv_stalled(false)
+		, send_pending(false)
+		, send_in_flight_bytes(0)
+		, send_queue_bytes(0)
+		, send_high_water(0)
+		, send_low_water(0)
+		, send_pressure(false)
+		, reported_send_pressure(false)
+		, orphaned(false)
+#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
+		, ssl_context(nullptr)
+#endif
+#ifdef LIBSLIRC_OPTION_WITH_IO_URING
+		, uring(nullptr)
+		, uring_recv(0)
+#endif
+		, status_handler([](const boost::system::error_code &){})
+		, recv_handler([](const char *, std::size_t length){ return length; })
+		, send_handler([](std::size_t){})
+		, send_pressure_handler([](bool){})
+		{}
+
+		void connect(const std::string &addr, const std::string &service_port) {
+			auto self = shared_from_this();
+			strand.dispatch([self, addr, service_port]() {
+				assert(self->state == socket_state::idle);
+				self->state = socket_state::connecting;
+				resolver_cache::instance().resolve(
+					self->service(), addr, service_port,
+					self->strand.wrap([self](const boost::system::error_code& error, tcp::resolver::iterator it) {
+						self->resolved(error, it);
+					})
+				);
+			});
+			poll_descriptor::instance().notify(service());
+		}
+
+		void accept(unsigned port) {
+			auto self = shared_from_this();
+			strand.dispatch([self, port]() {
+				assert(self->state == socket_state::idle);
+				self->state = socket_state::connecting;
+				self->start_accept(port);
+			});
+			poll_descriptor::instance().notify(service());
+		}
+
+		// takes over a socket accepted by a listener; must be called before
+		// any other function
+		void adopt(std::unique_ptr<tcp::socket> accepted) {
+			assert(state == socket_state::idle && !socket);
+			socket = std::move(accepted);
+			state = socket_state::connecting;
+			poll_descriptor::instance().watch(service(), socket->native_handle());
+		}
+
+		// reports an adopted socket as connected and starts recving
+		void start_adopted() {
+			auto self = shared_from_this();
+			strand.post([self]() {
+				if (self->state == socket_state::connecting) {
+					// uses the SSL context set up by the accept handler, if any
+					self->accepted();
+				}
+			});
+			poll_descriptor::instance().notify(service());
+		}
+
+		void disconnect() {
+			auto self = shared_from_this();
+			strand.dispatch([self]() {
+				self->close();
+			});
+			poll_descriptor::instance().notify(service());
+		}
+
+		// called when the connection object is destroyed
+		void orphan() {
+			orphaned = true;
+			disconnect();
+		}
+
+		void pause_recv() {
+			auto self = shared_from_this();
+			strand.dispatch([self]() {
+				self->recv_paused = true;
+#ifdef LIBSLIRC_OPTION_WITH_IO_URING
+				if (self->uring_recv) {
+					// ends the multishot receive; see uring_recv_completed()
+					self->uring->cancel(self->uring_recv);
+				}
+#endif
+			});
+			poll_descriptor::instance().notify(service());
+		}
+
+		void resume_recv() {
+			auto self = shared_from_this();
+			// Posted, not dispatched: resuming from within the receive handler
+			// (e.g. by a water mark handler) must not call it recursively.
+			strand.post([self]() {
+				self->recv_paused = false;
+				if (!self->recv_buffer.empty() && !self->orphaned) {
+					// data held back while paused
+					self->recv_buffer.consume(
+						self->recv_handler(self->recv_buffer.data(), self->recv_buffer.size()));
+				}
+				if (self->recv_stalled && !self->recv_paused) {
+					self->recv_stalled = false;
+					if (self->state == socket_state::connected) {
+						self->start_recv();
+					}
+				}
+			});
+			poll_descriptor::instance().notify(service());
+		}
+
+		void set_capture(std::shared_ptr<capture_writer> writer) {
+			auto self = shared_from_this();
+			strand.dispatch([self, writer]() {
+				if (self->capture) {
+					// written and closed outside the strand
+					self->capture->flush();
+				}
+				self->capture = writer;
+			});
+			poll_descriptor::instance().notify(service());
+		}
+
+		void set_send_watermarks(std::size_t high_water, std::size_t low_water) {
+			assert(!high_water || low_water < high_water);
+			send_low_water = low_water;
+			send_high_water = high_water;
+		}
+
+		void set_read_size(std::size_t min_size, std::size_t max_size) {
+			assert(0 < min_size && min_size <= max_size);
+			min_read_size = min_size;
+			max_read_size = max_size;
+			read_size = min_size;
+		}
+
+		// Wait-free: queues the data and posts a write, unless a write is in
+		// progress or has been posted already. Like every function posting
+		// from outside the strand, it wakes up manual runners to handle the
+		// posted handlers.
+		void send(send_chunk data) {
+			if (!data || data->empty()) {
+				return; // nothing to do
+			}
+
+			const std::size_t queued = send_queue_bytes += data->size();
+			const std::size_t high_water = send_high_water;
+			send_queue.push(std::move(data));
+			if (!send_pending.exchange(true)) {
+				auto self = shared_from_this();
+				strand.post([self]() { self->try_send(); });
+			}
+			if (high_water && queued >= high_water && !send_pressure.exchange(true)) {
+				auto self = shared_from_this();
+				strand.post([self]() { self->report_send_pressure(); });
+			}
+			poll_descriptor::instance().notify(service());
+		}
+
+	private:
+		// invokes the status handler, unless the connection object is gone
+		void report_status(const boost::system::error_code &error) {
+			if (!orphaned) {
+				status_handler(error);
+			}
+		}
+
+		// invokes the send pressure handler if the pressure has changed since
+		// it was last invoked
+		void report_send_pressure() {
+			const bool pressure = send_pressure;
+			if (pressure != reported_send_pressure) {
+				reported_send_pressure = pressure;
+				if (!orphaned) {
+					send_pressure_handler(pressure);
+				}
+			}
+		}
+
+		// accounts for data that has been sent or dropped
+		void sent(std::size_t bytes) {
+			const std::size_t queued = send_queue_bytes -= bytes;
+			bool pressure = true;
+			if (queued <= send_low_water && send_pressure.compare_exchange_strong(pressure, false)) {
+				report_send_pressure();
+			}
+		}
+
+		// closes the socket and all pending operations
+		void close() {
+			boost::system::error_code ignored_error;
+			if (state == socket_state::connecting && !socket && !acceptor && !attempts) {
+				// still resolving - tell the resolve handler not to connect
+				state = socket_state::closed;
+				return;
+			}
+			state = socket_state::closed;
+			if (capture) {
+				// nothing is going to follow for a while
+				capture->flush();
+			}
+
+			if (acceptor) {
+				acceptor->close(ignored_error);
+			}
+#ifdef LIBSLIRC_OPTION_WITH_IO_URING
+			if (uring_recv && !uring->cancel(uring_recv) && socket) {
+				// Closing the socket does not end the receive, but the end of
+				// the stream does.
+				socket->shutdown(tcp::socket::shutdown_receive, ignored_error);
+			}
+#endif
+			if (attempts && !attempts->finished) {
+				attempts->finished = true;
+				attempts->timer.cancel(ignored_error);
+				for(std::unique_ptr<tcp::socket> &attempt: attempts->sockets) {
+					attempt->close(ignored_error);
+				}
+				// the losers do not report anything, so report here
+				report_status(boost::asio::error::operation_aborted);
+			}
+			if (socket) {
+				socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_error);
+				socket->close(ignored_error);
+			}
+		}
+
+		// marks the connection as established, starts recving and sends
+		// everything queued in the meantime
+		void connected() {
+			state = socket_state::connected;
+			report_status(boost::system::error_code());
+			start_recv();
+			if (!send_pending.exchange(true)) {
+				try_send();
+			}
+		}
+
+		// marks the connection as lost and reports the reason
+		void failed(const boost::system::error_code &error) {
+			if (state != socket_state::closed) {
+				close();
+			}
+			report_status(error);
+		}
+
+		// handles the result of resolving the host name
+		void resolved(const boost::system::error_code &error, tcp::resolver::iterator it) {
+			if (state == socket_state::closed) {
+				report_status(boost::asio::error::operation_aborted);
+			}
+			else if (error) {
+				failed(error);
+			}
+			else if (connect_mode == connection::connect_mode::parallel) {
+				start_parallel_connect(it);
+			}
+			else {
+				resolver_context.reset(new resolver());
+				resolver_context->it = it;
+				assert(!socket);
+				socket.reset(new tcp::socket(service()));
+#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
+				if (ssl_context) {
+					ssl_stream.reset(new ssl::stream<tcp::socket>(*socket, *ssl_context));
+				}
+#endif
+				try_connect();
+			}
+		}
+
+		// waits for a single incoming connection
+		void start_accept(unsigned port) {
+			boost::system::error_code error;
+			acceptor.reset(new tcp::acceptor(service()));
+			open_acceptor(*acceptor, std::string(), port, false, error);
+			if (error) {
+				failed(error);
+				return;
+			}
+
+			socket.reset(new tcp::socket(service()));
+			poll_descriptor::instance().watch(service(), acceptor->native_handle());
+			auto self = shared_from_this();
+			acceptor->async_accept(*socket, strand.wrap([self](const boost::system::error_code &error) {
+				// only a single connection is accepted
+				boost::system::error_code ignored_error;
+				self->acceptor->close(ignored_error);
+				if (error) {
+					self->failed(error);
+				}
+				else {
+					poll_descriptor::instance().watch(self->service(), self->socket->native_handle());
+					self->accepted();
+				}
+			}));
+		}
+
+		// performs the server side SSL handshake on an accepted socket, if
+		// SSL is used, and marks the connection as established
+		void accepted() {
+#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
+			if (ssl_context) {
+				ssl_stream.reset(new ssl::stream<tcp::socket>(*socket, *ssl_context));
+				auto self = shared_from_this();
+				ssl_stream->async_handshake(ssl::stream_base::server, strand.wrap([self](const boost::system::error_code &error) {
+					if (self->state == socket_state::closed) {
+						self->report_status(error ? error : boost::asio::error::operation_aborted);
+					}
+					else if (error) {
+						self->failed(error);
+					}
+					else {
+						self->connected();
+					}
+				}));
+				return;
+			}
+#endif
+			connected();
+		}
+
+		// drains the send queue; called in the strand with send_pending set
+		void try_send() {
+			send_in_flight.clear();
+
+			if (state == socket_state::closed) {
+				// nobody is going to send this anymore
+				send_chunk dropped;
+				while (send_queue.pop(dropped)) {
+					sent(dropped->size());
+				}
+			}
+			if (state != socket_state::connected) {
+				// sent by connected() later, if ever
+				send_pending = false;
+				return;
+			}
+
+			// Take the next chunks out of the queue. They are immutable and
+			// kept alive by send_in_flight until the write has completed, so
+			// send() can go on queueing while they are being written.
+			send_chunk chunk;
+			send_in_flight_bytes = 0;
+			while (send_in_flight.size() < max_gathered_chunks && send_queue.pop(chunk)) {
+				send_in_flight_bytes += chunk->size();
+				send_in_flight.emplace_back(std::move(chunk));
+			}
+
+			if (send_in_flight.empty()) {
+				send_pending = false;
+				// A send() may have queued data after the last pop, but seen
+				// send_pending still set. Take over if nobody else has.
+				if (!send_queue.empty() && !send_pending.exchange(true)) {
+					auto self = shared_from_this();
+					// the data is not visible yet; try again shortly
+					strand.post([self]() { self->try_send(); });
+				}
+				return;
+			}
+
+			std::vector<boost::asio::const_buffer> buffers;
+			buffers.reserve(send_in_flight.size());
+			for(const send_chunk &chunk: send_in_flight) {
+				buffers.emplace_back(boost::asio::buffer(*chunk));
+			}
+
+			auto self = shared_from_this();
+			auto handler = strand.wrap([self](
+				const boost::system::error_code& error, // Result of operation.
+				std::size_t bytes_transferred
+			) {
+				if (bytes_transferred && self->capture) {
+					std::size_t remaining = bytes_transferred;
+					for(const send_chunk &chunk: self->send_in_flight) {
+						const std::size_t length = std::min(chunk->size(), remaining);
+						self->capture->write(capture_writer::sent, chunk->data(), length);
+						remaining -= length;
+					}
+				}
+				if (bytes_transferred && !self->orphaned) {
+					self->send_handler(bytes_transferred);
+				}
+				self->sent(self->send_in_flight_bytes);
+				self->send_in_flight_bytes = 0;
+				if (error) {
+					self->send_in_flight.clear();
+					self->send_pending = false;
+					self->failed(error);
+				}
+				else {
+					self->try_send();
+				}
+			});
+
+#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
+			if (ssl_stream)
+				boost::asio::async_write(*ssl_stream, buffers, handler);
+			else
+#endif
+				boost::asio::async_write(*socket, buffers, handler);
+		}
+
+		// attempts a connection to the next endpoint
+		void try_connect() {
+			assert(socket);
+
+			static const tcp::resolver::iterator end;
+			assert(resolver_context->it != end);
+
+			tcp::resolver::iterator current = resolver_context->it++;
+
+			auto self = shared_from_this();
+			socket->async_connect(
+				*current,
+				strand.wrap([self](const boost::system::error_code &error) {
+					static const tcp::resolver::iterator end;
+					if (self->state == socket_state::closed) {
+						self->report_status(error ? error : boost::asio::error::operation_aborted);
+					}
+					else if (error && end != self->resolver_context->it) {
+						// start over with a fresh socket for the next endpoint
+						boost::system::error_code ignored_error;
+						self->socket->close(ignored_error);
+						self->try_connect();
+					}
+					else if (error) {
+						// last endpoint failed connecting
+						self->failed(error);
+					}
+					else {
+						// It actually succeeded! - start recving here.
+						self->connected();
+					}
+				})
+			);
+			// async_connect() has opened the socket
+			poll_descriptor::instance().watch(service(), socket->native_handle());
+		}
+
+		// starts connecting to all endpoints in parallel, staggered by
+		// connect_attempt_delay as described in RFC 8305 ("happy eyeballs")
+		void start_parallel_connect(tcp::resolver::iterator it) {
+			std::shared_ptr<connect_attempts> state = std::make_shared<connect_attempts>(service());
+
+			// Alternate between address families, starting with the family
+			// of the first (i.e. preferred) address.
+			static const tcp::resolver::iterator end;
+			std::vector<tcp::endpoint> preferred, other;
+			for(; it != end; ++it) {
+				tcp::endpoint endpoint = *it;
+				if (preferred.empty() || preferred.front().protocol() == endpoint.protocol()) {
+					preferred.push_back(endpoint);
+				}
+				else {
+					other.push_back(endpoint);
+				}
+			}
+			for(std::size_t i=0; i<preferred.size() || i<other.size(); ++i) {
+				if (i < preferred.size()) state->endpoints.push_back(preferred[i]);
+				if (i < other.size()) state->endpoints.push_back(other[i]);
+			}
+
+			if (state->endpoints.empty()) {
+				failed(boost::asio::error::host_not_found);
+				return;
+			}
+			attempts = state;
+			try_next_attempt(state);
+		}
+
+		// starts the next parallel connection attempt and schedules the one
+		// after it
+		void try_next_attempt(std::shared_ptr<connect_attempts> state) {
+			assert(state->next < state->endpoints.size());
+
+			const tcp::endpoint &endpoint = state->endpoints[state->next++];
+			const std::size_t index = state->sockets.size();
+			state->sockets.emplace_back(new tcp::socket(service()));
+			++state->pending;
+			auto self = shared_from_this();
+			state->sockets[index]->async_connect(endpoint, strand.wrap(
+				[self, state, index](const boost::system::error_code &error) {
+					self->attempt_completed(state, index, error);
+				}
+			));
+			// async_connect() has opened the socket
+			poll_descriptor::instance().watch(service(), state->sockets[index]->native_handle());
+
+			if (state->next < state->endpoints.size()) {
+				// Don't wait for the attempt to time out before trying the
+				// next endpoint. Resetting the timer cancels an older wait.
+				state->timer.expires_from_now(connect_attempt_delay);
+				state->timer.async_wait(strand.wrap(
+					[self, state](const boost::system::error_code &error) {
+						if (!error && !state->finished && state->next < state->endpoints.size()) {
+							self->try_next_attempt(state);
+						}
+					}
+				));
+			}
+		}
+
+		// handles the result of a parallel connection attempt: the first
+		// success wins, the other attempts are cancelled
+		void attempt_completed(std::shared_ptr<connect_attempts> state, std::size_t index, const boost::system::error_code &error) {
+			--state->pending;
+			if (state->finished) {
+				return; // a cancelled loser
+			}
+
+			if (error) {
+				state->last_error = error;
+				if (state->next < state->endpoints.size()) {
+					// no need to wait for the delay if the attempt failed
+					try_next_attempt(state);
+				}
+				else if (!state->pending) {
+					// all endpoints failed
+					state->finished = true;
+					failed(error);
+				}
+				return;
+			}
+
+			state->finished = true;
+			boost::system::error_code ignored_error;
+			state->timer.cancel(ignored_error);
+			for(std::size_t i=0; i<state->sockets.size(); ++i) {
+				if (i != index) {
+					state->sockets[i]->close(ignored_error);
+				}
+			}
+
+			assert(!socket);
+			socket = std::move(state->sockets[index]);
+#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
+			if (ssl_context) {
+				ssl_stream.reset(new ssl::stream<tcp::socket>(*socket, *ssl_context));
+			}
+#endif
+			connected();
+		}
+
+		// updates the statistics and grows the read size if a read filled the
+		// buffer, or shrinks it after several reads used only a fraction of it
+		void adapt_read_size(std::size_t requested, std::size_t bytes_transferred) {
+			++stat_reads;
+			stat_bytes += bytes_transferred;
+
+			const std::size_t min_size = min_read_size;
+			const std::size_t max_size = max_read_size;
+			if (bytes_transferred == requested) {
+				++stat_full_reads;
+				small_reads = 0;
+				read_size = std::min(2 * requested, max_size);
+			}
+			else if (bytes_transferred < requested / 4) {
+				if (++small_reads >= shrink_after_small_reads) {
+					small_reads = 0;
+					read_size = std::max(requested / 2, min_size);
+					if (recv_buffer.empty()) {
+						// Things have calmed down; give back the memory of
+						// earlier bursts.
+						recv_buffer.shrink(4 * read_size);
+					}
+				}
+			}
+			else {
+				small_reads = 0;
+			}
+		}
+
+		// starts recving with the selected backend, or with the reactor if
+		// allow_uring is not set
+		void start_recv(bool allow_uring = true) {
+			if (recv_paused) {
+				recv_stalled = true;
+				return;
+			}
+
+#ifdef LIBSLIRC_OPTION_WITH_IO_URING
+			bool use_uring = allow_uring && current_io_backend() == io_backend::io_uring;
+#	ifndef LIBSLIRC_OPTION_WITHOUT_SSL
+			// SSL streams do their own reading
+			use_uring = use_uring && !ssl_stream;
+#	endif
+			if (use_uring) {
+				if (!uring) {
+					uring = &boost::asio::use_service<uring_service>(service());
+				}
+				if (uring->available() && start_uring_recv()) {
+					return;
+				}
+			}
+#else
+			static_cast<void>(allow_uring);
+#endif
+			try_recv();
+		}
+
+#ifdef LIBSLIRC_OPTION_WITH_IO_URING
+		// starts a multishot receive; its completions are passed to the
+		// strand in order
+		// returns false if the ring could not take the receive, so the
+		// reactor has to be used instead
+		bool start_uring_recv() {
+			auto self = shared_from_this();
+			uring_recv = uring->start_recv(socket->native_handle(), [self](
+				const boost::system::error_code &error,
+				const char *data,
+				std::size_t bytes_transferred,
+				unsigned buffer,
+				bool more
+			) {
+				self->strand.post([self, error, data, bytes_transferred, buffer, more]() {
+					self->uring_recv_completed(error, data, bytes_transferred, buffer, more);
+				});
+			});
+			return uring_recv != 0;
+		}
+
+		// handles a completion of the multishot receive
+		void uring_recv_completed(const boost::system::error_code &error, const char *data, std::size_t bytes_transferred, unsigned buffer, bool more) {
+			if (bytes_transferred && capture) {
+				capture->write(capture_writer::received, data, bytes_transferred);
+			}
+			if (bytes_transferred && !orphaned) {
+				++stat_reads;
+				stat_bytes += bytes_transferred;
+				if (recv_paused) {
+					// Data received before the receive has been cancelled;
+					// keep it until resume_recv().
+					std::copy(data, data + bytes_transferred, recv_buffer.prepare(bytes_transferred));
+					recv_buffer.commit(bytes_transferred);
+				}
+				else if (recv_buffer.empty()) {
+					// common case: hand out the kernel's buffer directly and
+					// keep only an incomplete line
+					const std::size_t consumed = recv_handler(data, bytes_transferred);
+					const std::size_t remaining = bytes_transferred - consumed;
+					std::copy(data + consumed, data + bytes_transferred, recv_buffer.prepare(remaining));
+					recv_buffer.commit(remaining);
+				}
+				else {
+					std::copy(data, data + bytes_transferred, recv_buffer.prepare(bytes_transferred));
+					recv_buffer.commit(bytes_transferred);
+					recv_buffer.consume(
+						recv_handler(recv_buffer.data(), recv_buffer.size()));
+				}
+			}
+			if (buffer != uring_service::no_buffer) {
+				uring->release(buffer);
+			}
+
+			if (!more) {
+				uring_recv = 0;
+				if (state == socket_state::connected && (
+					!error ||
+					// cancelled by pause_recv()
+					error == boost::asio::error::operation_aborted
+				)) {
+					start_recv();
+				}
+				else if (state == socket_state::connected && error == boost::asio::error::no_buffer_space) {
+					// The buffers are held by strands busy with earlier data.
+					// Resubmitting right away would fail again, so wait for
+					// the next data with the reactor; the read after it goes
+					// back to the ring.
+					start_recv(false);
+				}
+				else if (error) {
+					failed(error);
+				}
+			}
+		}
+#endif
+
+		// attempts recving from the socket
+		void try_recv() {
+			assert(socket);
+
+			const std::size_t requested = read_size;
+			auto buffer = boost::asio::buffer(
+				recv_buffer.prepare(requested),
+				requested);
+			auto self = shared_from_this();
+			auto reader = strand.wrap([self, requested](
+				const boost::system::error_code& error, // Result of operation.
+				std::size_t bytes_transferred           // Number of bytes recv
+			) {
+				if (error) {
+					self->failed(error);
+				}
+				else if (!self->orphaned) {
+					helper::linear_buffer &recv_buffer = self->recv_buffer;
+					recv_buffer.commit(bytes_transferred);
+					if (self->capture) {
+						self->capture->write(capture_writer::received,
+							recv_buffer.data() + recv_buffer.size() - bytes_transferred, bytes_transferred);
+					}
+					recv_buffer.consume(
+						self->recv_handler(recv_buffer.data(), recv_buffer.size()));
+					self->adapt_read_size(requested, bytes_transferred);
+					if (self->recv_paused) {
+						self->recv_stalled = true;
+					}
+					else {
+						self->start_recv(); // and recv some more!
+					}
+				}
+			});
+
+#ifndef LIBSLIRC_OPTION_WITHOUT_SSL
+			if (ssl_stream)
+				ssl_stream->async_receive(buffer, reader);
+			else
+#endif
+				socket->async_receive(buffer, reader);
+		}
+	};
+}
+}
+}
+
+#endif // LIBSLIRC_HDR_NETWORK_CONNECTION_IMPLEMENTATION_HPP_INCLUDED
@@ -0,0 +1,275 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#include "listener.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include "connection_implementation.hpp"
+
+namespace {
+	// how long to wait before accepting again after running out of resources
+	const std::chrono::milliseconds accept_backoff(100);
+
+	// checks whether accepting failed because the process or the system ran
+	// out of resources, so retrying right away would fail again
+	bool out_of_resources(const boost::system::error_code &error) {
+		if (error.category() != boost::system::system_category()) {
+			return false;
+		}
+		switch (error.value()) {
+		case EMFILE:
+		case ENFILE:
+		case ENOBUFS:
+		case ENOMEM:
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+namespace slirc {
+namespace network {
+namespace detail {
+	struct listener_implementation: std::enable_shared_from_this<listener_implementation> {
+		static const std::size_t default_max_batch = 16;
+
+		// the io_service the acceptors and accepted connections are run on
+		boost::asio::io_service &io;
+
+		inline boost::asio::io_service &service() const {
+			return io;
+		}
+
+		// a single acceptor together with the socket accepting into; all of
+		// it but closed is owned by the strand once accepting has started
+		struct acceptor_slot {
+			acceptor_slot(boost::asio::io_service &service)
+			: acceptor(service)
+			, strand(service)
+			, backoff(service)
+			, closed(false)
+			{}
+
+			tcp::acceptor acceptor;
+			boost::asio::io_service::strand strand;
+			std::unique_ptr<tcp::socket> socket;
+			boost::asio::steady_timer backoff; // delays accepting after errors
+			// set by close(); connections accepted after that are dropped
+			std::atomic<bool> closed;
+		};
+		// the slots of the current listen(); the handlers keep their slot
+		// alive until they have drained after close()
+		std::vector<std::shared_ptr<acceptor_slot>> slots;
+		unsigned acceptor_count;
+		unsigned bound_port;
+		std::size_t max_batch;
+
+		slirc::network::listener::accept_handler_type accept_handler;
+		slirc::network::connection::status_handler_type status_handler;
+
+		listener_implementation(boost::asio::io_service &service, unsigned acceptor_count)
+		: io(service)
+		, acceptor_count(acceptor_count)
+		, bound_port(0)
+		, max_batch(default_max_batch)
+		, accept_handler([](std::shared_ptr<connection>){})
+		, status_handler([](const boost::system::error_code &){})
+		{}
+
+		void listen(const std::string &address, unsigned port) {
+			assert(slots.empty());
+
+#ifdef SO_REUSEPORT
+			// one acceptor per thread, the kernel balances between them
+			const unsigned count = std::max(1u, acceptor_count);
+#else
+			const unsigned count = 1;
+#endif
+
+			boost::system::error_code error;
+			for(unsigned i=0; i<count; ++i) {
+				std::shared_ptr<acceptor_slot> slot = std::make_shared<acceptor_slot>(service());
+				open_acceptor(slot->acceptor, address, port, count > 1, error);
+				if (!error) {
+					// needed to accept batches without blocking
+					slot->acceptor.non_blocking(true, error);
+				}
+				if (error) {
+					close();
+					throw boost::system::system_error(error);
+				}
+
+				poll_descriptor::instance().watch(service(), slot->acceptor.native_handle());
+
+				// if an unused port was requested, all further acceptors have
+				// to share the port picked for the first one
+				port = slot->acceptor.local_endpoint().port();
+				slots.emplace_back(std::move(slot));
+			}
+			bound_port = port;
+
+			for(std::shared_ptr<acceptor_slot> &slot: slots) {
+				accept_next(slot);
+			}
+		}
+
+		void close() {
+			for(std::shared_ptr<acceptor_slot> &slot: slots) {
+				slot->closed = true;
+				// The accept and backoff handlers use the acceptor and the
+				// timer concurrently, so close them in the strand as well.
+				slot->strand.post([slot]() {
+					boost::system::error_code ignored_error;
+					slot->acceptor.close(ignored_error);
+					slot->backoff.cancel(ignored_error);
+				});
+			}
+			if (!slots.empty()) {
+				poll_descriptor::instance().notify(service());
+			}
+			slots.clear();
+			bound_port = 0;
+		}
+
+	private:
+		void accept_next(std::shared_ptr<acceptor_slot> slot) {
+			// the handler keeps the implementation and the slot alive until
+			// the acceptor is closed
+			std::shared_ptr<listener_implementation> self = shared_from_this();
+
+			slot->socket.reset(new tcp::socket(service()));
+			slot->acceptor.async_accept(*slot->socket, slot->strand.wrap(
+				[self, slot](const boost::system::error_code &error) {
+					if (error == boost::asio::error::operation_aborted || slot->closed) {
+						return; // listener has been closed
+					}
+
+					if (error) {
+						self->status_handler(error);
+						if (out_of_resources(error)) {
+							// Give the application a chance to close some
+							// connections instead of failing in a busy loop.
+							self->accept_later(slot);
+							return;
+						}
+					}
+					else {
+						self->deliver(*slot, std::move(slot->socket));
+
+						// Connections tend to come in bursts: accept the ones
+						// already pending without waiting for the reactor.
+						for(std::size_t i=1; i<self->max_batch && !slot->closed; ++i) {
+							std::unique_ptr<tcp::socket> next(new tcp::socket(self->service()));
+							boost::system::error_code batch_error;
+							slot->acceptor.accept(*next, batch_error);
+							if (batch_error) {
+								// most likely would_block; real errors will
+								// be reported by the next async_accept
+								break;
+							}
+							self->deliver(*slot, std::move(next));
+						}
+					}
+
+					self->accept_next(slot);
+				}
+			));
+		}
+
+		void accept_later(std::shared_ptr<acceptor_slot> slot) {
+			std::shared_ptr<listener_implementation> self = shared_from_this();
+
+			slot->backoff.expires_from_now(accept_backoff);
+			slot->backoff.async_wait(slot->strand.wrap(
+				[self, slot](const boost::system::error_code &error) {
+					if (error != boost::asio::error::operation_aborted && !slot->closed) {
+						self->accept_next(slot);
+					}
+				}
+			));
+		}
+
+		void deliver(const acceptor_slot &slot, std::unique_ptr<tcp::socket> socket) {
+			if (slot.closed) {
+				return; // accepted after close(); the socket is closed here
+			}
+
+			std::shared_ptr<connection> conn = std::make_shared<connection>(service());
+			conn->impl->adopt(std::move(socket));
+
+			accept_handler(conn);
+
+			if (conn.use_count() > 1) {
+				// uses the SSL context set up by the handler, if any
+				conn->impl->start_adopted();
+			}
+			// else: nobody is interested, the connection closes right away
+		}
+	};
+}
+}
+}
+
+slirc::network::listener::listener()
+: impl(std::make_shared<detail::listener_implementation>(
+	network::service, network::worker_threads())) {}
+
+slirc::network::listener::listener(boost::asio::io_service &service, unsigned acceptors)
+: impl(std::make_shared<detail::listener_implementation>(service, acceptors)) {}
+
+slirc::network::listener::~listener() {
+	impl->close();
+}
+
+void slirc::network::listener::on_accept(accept_handler_type accept_handler) {
+	impl->accept_handler = accept_handler;
+}
+
+void slirc::network::listener::on_status(connection::status_handler_type status_handler) {
+	impl->status_handler = status_handler;
+}
+
+void slirc::network::listener::set_accept_batch(std::size_t max_batch) {
+	impl->max_batch = std::max<std::size_t>(1, max_batch);
+}
+
+void slirc::network::listener::listen(unsigned port) {
+	impl->listen(std::string(), port);
+}
+
+void slirc::network::listener::listen(const std::string &address, unsigned port) {
+	impl->listen(address, port);
+}
+
+unsigned slirc::network::listener::port() const {
+	return impl->bound_port;
+}
+
+void slirc::network::listener::close() {
+	impl->close();
+}
@@ -0,0 +1,184 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_NETWORK_LISTENER_HPP_INCLUDED
+#define LIBSLIRC_HDR_NETWORK_LISTENER_HPP_INCLUDED
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+#include "connection.hpp"
+
+namespace slirc {
+namespace network {
+
+namespace detail {
+	struct listener_implementation;
+}
+
+/**
+ * \brief Accepts any number of connections from remote clients.
+ *
+ * Where the platform supports SO_REUSEPORT, one acceptor is opened per
+ * thread running the io_service (see set_worker_threads()) and the operating
+ * system distributes incoming connections among them. Connections arriving in a
+ * burst are accepted in batches instead of going through the event loop for
+ * each one of them.
+ */
+struct listener: private boost::noncopyable {
+	/**
+	 * \brief Callback type for accept handlers.
+	 */
+	typedef std::function<
+		void(std::shared_ptr<connection>)
+	> accept_handler_type;
+
+	/**
+	 * \brief Constructs a listener.
+	 *
+	 * The listener and all connections it accepts are run by libslirc's own
+	 * io_service (network::service).
+	 */
+	listener();
+
+	/**
+	 * \brief Constructs a listener run by an application supplied io_service.
+	 *
+	 * The listener and all connections it accepts are run by the given
+	 * io_service.
+	 *
+	 * \param service The io_service to run the listener and its connections
+	 *                on. It has to outlive them.
+	 * \param acceptors The number of acceptors to open where SO_REUSEPORT is
+	 *                  supported; usually the number of threads running the
+	 *                  io_service.
+	 */
+	listener(boost::asio::io_service &service, unsigned acceptors);
+
+	/**
+	 * \brief Destructs a listener.
+	 *
+	 * Stops listening. Connections which have already been accepted are not
+	 * affected.
+	 */
+	~listener();
+
+	/**
+	 * \brief Sets up a handler for accepted connections.
+	 *
+	 * The handler is passed every newly accepted connection. It should set up
+	 * the handlers for the connection (see connection::on_status(),
+	 * connection::on_recv() and connection::on_send()) and keep a copy of the
+	 * pointer for as long as the connection should stay open.
+	 *
+	 * Once the handler returns, the connection's status handler is called to
+	 * report the connection as established, and receiving starts. If the
+	 * handler did not keep a copy of the pointer, the connection is closed
+	 * instead. To use SSL on the connection, call connection::use_ssl() from
+	 * the handler.
+	 *
+	 * \param accept_handler The accept handler callback to be set.
+	 *
+	 * \note The handler passed may be called from different threads, even
+	 *       concurrently. Make sure to properly synchronize its
+	 *       implementation.
+	 *
+	 * \note This function should only be called before calling listen()
+	 */
+	void on_accept(accept_handler_type accept_handler);
+
+	/**
+	 * \brief Sets up a handler for errors while accepting connections.
+	 *
+	 * After errors caused by a lack of resources (e.g. too many open files),
+	 * the listener waits a moment before accepting again.
+	 *
+	 * \param status_handler The status handler callback to be set.
+	 *
+	 * \note The handler passed may be called from different threads, even
+	 *       concurrently. Make sure to properly synchronize its
+	 *       implementation.
+	 *
+	 * \note This function should only be called before calling listen()
+	 */
+	void on_status(connection::status_handler_type status_handler);
+
+	/**
+	 * \brief Sets how many pending connections are accepted at once.
+	 *
+	 * \param max_batch The maximum number of connections accepted per wake up
+	 *                  of an acceptor. Defaults to 16.
+	 *
+	 * \note This function should only be called before calling listen()
+	 */
+	void set_accept_batch(std::size_t max_batch);
+
+	/**
+	 * \brief Starts listening for connections on all interfaces.
+	 *
+	 * \param port The port number to listen on. If set to 0, an unused port
+	 *             is picked; use port() to find out which.
+	 *
+	 * \throw boost::system::system_error if listening fails.
+	 */
+	void listen(unsigned port);
+
+	/**
+	 * \brief Starts listening for connections on a single address.
+	 *
+	 * \param address The IP address of the interface to listen on.
+	 * \param port The port number to listen on. If set to 0, an unused port
+	 *             is picked; use port() to find out which.
+	 *
+	 * \throw boost::system::system_error if listening fails.
+	 */
+	void listen(const std::string &address, unsigned port);
+
+	/**
+	 * \brief Returns the port number the listener is listening on.
+	 *
+	 * \return The port number or 0 if the listener is not listening.
+	 */
+	unsigned port() const;
+
+	/**
+	 * \brief Stops listening.
+	 *
+	 * Connections accepted after this call are closed right away instead of
+	 * being passed to the accept handler. The acceptors are closed by the
+	 * io_service; listen() may be called again right away, but listening on
+	 * the same port may fail until the io_service has done so.
+	 */
+	void close();
+
+private:
+	std::shared_ptr<detail::listener_implementation> impl;
+};
+
+}
+}
+
+#endif // LIBSLIRC_HDR_NETWORK_LISTENER_HPP_INCLUDED
@@ -0,0 +1,120 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#include "poll_descriptor.hpp"
+
+#include "../network.hpp"
+
+#if defined(BOOST_ASIO_HAS_EPOLL)
+#	include <cstdint>
+#	include <sys/epoll.h>
+#	include <sys/eventfd.h>
+#	include <unistd.h>
+#endif
+
+slirc::network::detail::poll_descriptor &slirc::network::detail::poll_descriptor::instance() {
+	static poll_descriptor descriptor;
+	return descriptor;
+}
+
+#if defined(BOOST_ASIO_HAS_EPOLL)
+
+slirc::network::detail::poll_descriptor::poll_descriptor()
+: fd(epoll_create1(EPOLL_CLOEXEC))
+, wakeup_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+, notified(false) {
+	if (fd != -1 && wakeup_fd != -1) {
+		// Level triggered, so the descriptor stays readable until drained.
+		epoll_event ev = epoll_event();
+		ev.events = EPOLLIN;
+		epoll_ctl(fd, EPOLL_CTL_ADD, wakeup_fd, &ev);
+	}
+}
+
+slirc::network::detail::poll_descriptor::~poll_descriptor() {
+	if (wakeup_fd != -1) {
+		close(wakeup_fd);
+	}
+	if (fd != -1) {
+		close(fd);
+	}
+}
+
+void slirc::network::detail::poll_descriptor::watch(boost::asio::io_service &service, native_handle_type socket) {
+	if (fd != -1 && &service == &network::service) {
+		// Edge triggered, so writable sockets do not keep the descriptor
+		// readable. The actual I/O is still done by the io_service.
+		epoll_event ev = epoll_event();
+		ev.events = EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP | EPOLLET;
+		epoll_ctl(fd, EPOLL_CTL_ADD, socket, &ev);
+	}
+}
+
+void slirc::network::detail::poll_descriptor::notify(boost::asio::io_service &service) {
+	// In automatic mode, nobody drains, so this stays a single load.
+	if (wakeup_fd != -1 && &service == &network::service && !notified.load(std::memory_order_relaxed) && !notified.exchange(true)) {
+		const std::uint64_t one = 1;
+		static_cast<void>(write(wakeup_fd, &one, sizeof(one)));
+	}
+}
+
+void slirc::network::detail::poll_descriptor::drain() {
+	if (wakeup_fd != -1) {
+		// Handlers notified about before this are run by the caller.
+		notified = false;
+		std::uint64_t count;
+		static_cast<void>(read(wakeup_fd, &count, sizeof(count)));
+	}
+	if (fd != -1) {
+		static const int batch = 64;
+		epoll_event events[batch];
+		while(epoll_wait(fd, events, batch, 0) == batch) {
+			// more events pending
+		}
+	}
+}
+
+#else
+
+slirc::network::detail::poll_descriptor::poll_descriptor()
+: fd(-1)
+, wakeup_fd(-1)
+, notified(false) {}
+
+slirc::network::detail::poll_descriptor::~poll_descriptor() {}
+
+void slirc::network::detail::poll_descriptor::watch(boost::asio::io_service &service, native_handle_type socket) {
+	static_cast<void>(service);
+	static_cast<void>(socket);
+}
+
+void slirc::network::detail::poll_descriptor::notify(boost::asio::io_service &service) {
+	static_cast<void>(service);
+}
+
+void slirc::network::detail::poll_descriptor::drain() {}
+
+#endif
+
+int slirc::network::detail::poll_descriptor::native_handle() const {
+	return fd;
+}
@@ -0,0 +1,99 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_NETWORK_POLL_DESCRIPTOR_HPP_INCLUDED
+#define LIBSLIRC_HDR_NETWORK_POLL_DESCRIPTOR_HPP_INCLUDED
+
+#include <atomic>
+
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace slirc {
+namespace network {
+namespace detail {
+	/**
+	 * \brief A descriptor for external event loops to wait on.
+	 *
+	 * Where epoll is available, this is an epoll descriptor watching all
+	 * sockets of libslirc, which becomes readable whenever one of them
+	 * becomes ready, or when notify() has been called. It is meant to be
+	 * added to the event loop of the application, which then processes the
+	 * network manually.
+	 */
+	struct poll_descriptor: private boost::noncopyable {
+		typedef boost::asio::ip::tcp::socket::native_handle_type native_handle_type;
+
+		/**
+		 * \brief Returns the process wide instance.
+		 */
+		static poll_descriptor &instance();
+
+		/**
+		 * \brief Returns the descriptor or -1 if it is not supported.
+		 */
+		int native_handle() const;
+
+		/**
+		 * \brief Adds a socket to the watched descriptors.
+		 *
+		 * Sockets are removed automatically when they are closed. Sockets
+		 * run by an application supplied io_service are ignored, as the
+		 * network functions do not run it.
+		 *
+		 * \param service The io_service the socket is run by.
+		 * \param socket The socket to watch.
+		 */
+		void watch(boost::asio::io_service &service, native_handle_type socket);
+
+		/**
+		 * \brief Makes the descriptor readable until the next drain().
+		 *
+		 * To be called when handlers become ready without socket activity,
+		 * e.g. when they are posted by the application or were left over
+		 * by a bounded run. Cheap if the descriptor is readable already.
+		 * Ignored for application supplied io_services, like watch().
+		 *
+		 * \param service The io_service the handlers are run by.
+		 */
+		void notify(boost::asio::io_service &service);
+
+		/**
+		 * \brief Resets the descriptor to not readable.
+		 *
+		 * Has to be called before processing the pending network events.
+		 */
+		void drain();
+
+	private:
+		poll_descriptor();
+		~poll_descriptor();
+
+		int fd;
+		int wakeup_fd; // an eventfd watched level triggered
+		std::atomic<bool> notified;
+	};
+}
+}
+}
+
+#endif // LIBSLIRC_HDR_NETWORK_POLL_DESCRIPTOR_HPP_INCLUDED
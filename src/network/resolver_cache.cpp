@@ -0,0 +1,130 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#include "resolver_cache.hpp"
+
+#include <algorithm>
+
+slirc::network::detail::resolver_cache &slirc::network::detail::resolver_cache::instance() {
+	static resolver_cache cache;
+	return cache;
+}
+
+slirc::network::detail::resolver_cache::resolver_cache()
+: positive_ttl(std::chrono::seconds(60))
+, negative_ttl(std::chrono::seconds(5)) {}
+
+void slirc::network::detail::resolver_cache::resolve(boost::asio::io_service &service, const std::string &host, const std::string &service_port, handler_type handler) {
+	const key_type key(host, service_port);
+
+	boost::mutex::scoped_lock lock(cache_mutex);
+	const clock::time_point now = clock::now();
+	if (now >= next_eviction) {
+		evict(now);
+	}
+	entry &e = entries[key];
+
+	if (e.query) {
+		// somebody is already asking - just wait for the answer
+		e.waiters.emplace_back(&service, std::move(handler));
+		return;
+	}
+
+	if (now < e.expires) {
+		boost::system::error_code error = e.error;
+		tcp::resolver::iterator result = e.result;
+		lock.unlock();
+		service.post([=](){ handler(error, result); });
+		return;
+	}
+
+	e.waiters.emplace_back(&service, std::move(handler));
+	e.query.reset(new tcp::resolver(service));
+	e.query->async_resolve(
+		tcp::resolver::query(host, service_port),
+		[this, key](const boost::system::error_code &error, tcp::resolver::iterator result) {
+			completed(key, error, result);
+		}
+	);
+}
+
+void slirc::network::detail::resolver_cache::completed(const key_type &key, const boost::system::error_code &error, tcp::resolver::iterator result) {
+	std::unique_ptr<tcp::resolver> query;
+	std::vector<waiter_type> waiters;
+
+	{ boost::mutex::scoped_lock lock(cache_mutex);
+		entry &e = entries[key];
+		std::swap(query, e.query); // destroyed after leaving the handler
+		std::swap(waiters, e.waiters);
+
+		e.error = error;
+		e.result = result;
+		if (error == boost::asio::error::operation_aborted) {
+			// not an answer - don't keep it
+			e.expires = clock::time_point();
+		}
+		else {
+			e.expires = clock::now() + (error ? negative_ttl : positive_ttl);
+		}
+	}
+
+	for(waiter_type &waiter: waiters) {
+		// Lookups from other io_services joined the query; answer each one
+		// on its own.
+		handler_type handler = std::move(waiter.second);
+		waiter.first->post([handler, error, result]() {
+			handler(error, result);
+		});
+	}
+}
+
+void slirc::network::detail::resolver_cache::evict(clock::time_point now) {
+	for(auto it = entries.begin(); it != entries.end(); ) {
+		if (!it->second.query && it->second.expires <= now) {
+			it = entries.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	// Sweeping at most this often keeps lookups cheap; a stale entry is
+	// never used anyway.
+	next_eviction = now + std::min(positive_ttl, negative_ttl);
+}
+
+void slirc::network::detail::resolver_cache::set_ttl(clock::duration positive, clock::duration negative) {
+	boost::mutex::scoped_lock lock(cache_mutex);
+	positive_ttl = positive;
+	negative_ttl = negative;
+}
+
+void slirc::network::detail::resolver_cache::clear() {
+	boost::mutex::scoped_lock lock(cache_mutex);
+	for(auto it = entries.begin(); it != entries.end(); ) {
+		if (it->second.query) {
+			++it; // still waited for
+		}
+		else {
+			it = entries.erase(it);
+		}
+	}
+}
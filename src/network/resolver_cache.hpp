@@ -0,0 +1,123 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_NETWORK_RESOLVER_CACHE_HPP_INCLUDED
+#define LIBSLIRC_HDR_NETWORK_RESOLVER_CACHE_HPP_INCLUDED
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace slirc {
+namespace network {
+namespace detail {
+	/**
+	 * \brief Process wide cache for host name resolution.
+	 *
+	 * Results are kept for a fixed time, since the resolver does not provide
+	 * the TTLs of the records. Failures are cached as well, for a shorter
+	 * time. Concurrent lookups of the same host and service share a single
+	 * query. Expired results are dropped by later lookups.
+	 */
+	struct resolver_cache: private boost::noncopyable {
+		typedef boost::asio::ip::tcp tcp;
+		typedef std::chrono::steady_clock clock;
+
+		typedef std::function<
+			void(const boost::system::error_code &, tcp::resolver::iterator)
+		> handler_type;
+
+		/**
+		 * \brief Returns the process wide instance.
+		 */
+		static resolver_cache &instance();
+
+		/**
+		 * \brief Resolves a host name and service asynchronously.
+		 *
+		 * \param service The io_service to run a query on, if one is needed,
+		 *                and to call the handler on.
+		 * \param host The host name to resolve.
+		 * \param service_port The service name or port number to resolve.
+		 * \param handler The handler to be called with the result. It is
+		 *                never called from within this function.
+		 *
+		 * \note A lookup joining a query started by another lookup waits for
+		 *       the io_service of that one, even if it passed a different
+		 *       io_service. Its handler is still called on its own.
+		 */
+		void resolve(boost::asio::io_service &service, const std::string &host, const std::string &service_port, handler_type handler);
+
+		/**
+		 * \brief Sets how long results are kept.
+		 *
+		 * \param positive How long successful lookups are kept.
+		 * \param negative How long failed lookups are kept.
+		 */
+		void set_ttl(clock::duration positive, clock::duration negative);
+
+		/**
+		 * \brief Drops all cached results.
+		 *
+		 * Queries in progress are not affected.
+		 */
+		void clear();
+
+	private:
+		resolver_cache();
+
+		typedef std::pair<std::string, std::string> key_type;
+
+		// a lookup waiting for a query, with the io_service to answer it on
+		typedef std::pair<boost::asio::io_service *, handler_type> waiter_type;
+
+		struct entry {
+			clock::time_point expires;
+			boost::system::error_code error;
+			tcp::resolver::iterator result;
+			std::unique_ptr<tcp::resolver> query; // set while a query is running
+			std::vector<waiter_type> waiters; // waiting for the running query
+		};
+
+		void completed(const key_type &key, const boost::system::error_code &error, tcp::resolver::iterator result);
+		// drops the expired results; cache_mutex has to be locked
+		void evict(clock::time_point now);
+
+		boost::mutex cache_mutex;
+			std::map<key_type, entry> entries;
+			clock::duration positive_ttl;
+			clock::duration negative_ttl;
+			clock::time_point next_eviction;
+	};
+}
+}
+}
+
+#endif // LIBSLIRC_HDR_NETWORK_RESOLVER_CACHE_HPP_INCLUDED
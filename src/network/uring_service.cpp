@@ -0,0 +1,482 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#include "uring_service.hpp"
+
+#ifdef LIBSLIRC_OPTION_WITH_IO_URING
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "poll_descriptor.hpp"
+
+namespace {
+	const unsigned submission_entries = 256;
+	const unsigned completion_entries = 4096;
+	// power of 2; the number of reads that can be in progress at once
+	const unsigned buffer_count = 256;
+	const std::size_t buffer_size = 16 * 1024;
+	const unsigned short buffer_group = 0;
+	// how often a submission is retried while the kernel is out of resources
+	const unsigned submit_attempts = 16;
+
+	int io_uring_setup(unsigned entries, io_uring_params *params) {
+		return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+	}
+
+	int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+		return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+	}
+
+	int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+		return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+	}
+
+	// maps memory of the ring into the process; returns nullptr on failure
+	void *map_ring(int fd, std::size_t size, off_t offset) {
+		void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+		return memory == MAP_FAILED ? nullptr : memory;
+	}
+
+	// allocates page aligned memory for a buffer ring; returns nullptr on
+	// failure
+	void *map_buffer_ring(std::size_t size) {
+		void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return memory == MAP_FAILED ? nullptr : memory;
+	}
+
+	bool register_buffer_ring(int fd, void *ring, unsigned entries) {
+		io_uring_buf_reg reg;
+		std::memset(&reg, 0, sizeof(reg));
+		reg.ring_addr = reinterpret_cast<std::uintptr_t>(ring);
+		reg.ring_entries = entries;
+		reg.bgid = buffer_group;
+		return io_uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+	}
+
+	// Sets a buffer ring entry. Must not touch the resv field of the first
+	// entry, which doubles as the tail of the ring.
+	void set_buffer(void *ring, unsigned index, char *data, std::size_t size, unsigned short buffer_id) {
+		io_uring_buf &entry = static_cast<io_uring_buf *>(ring)[index];
+		entry.addr = reinterpret_cast<std::uintptr_t>(data);
+		entry.len = static_cast<std::uint32_t>(size);
+		entry.bid = buffer_id;
+	}
+
+	void publish_buffers(void *ring, unsigned short tail) {
+		__atomic_store_n(&static_cast<io_uring_buf_ring *>(ring)->tail, tail, __ATOMIC_RELEASE);
+	}
+
+	template <typename T>
+	T *at(void *memory, std::size_t offset) {
+		return reinterpret_cast<T *>(static_cast<char *>(memory) + offset);
+	}
+}
+
+boost::asio::io_service::id slirc::network::detail::uring_service::id;
+
+bool slirc::network::detail::uring_service::supported() {
+	static const bool is_supported = []() {
+		// setup() checks for every feature used
+		boost::asio::io_service probe;
+		return boost::asio::use_service<uring_service>(probe).available();
+	}();
+	return is_supported;
+}
+
+slirc::network::detail::uring_service::uring_service(boost::asio::io_service &owner)
+: boost::asio::io_service::service(owner)
+, ring_fd(-1)
+, event_fd(-1)
+, event_descriptor(owner)
+, event_count(0)
+, sq_memory(nullptr)
+, sq_memory_size(0)
+, cq_memory(nullptr)
+, cq_memory_size(0)
+, sqe_memory(nullptr)
+, sqe_memory_size(0)
+, buffer_ring_memory(nullptr)
+, buffer_ring_size(0)
+, sq_tail(nullptr)
+, sq_mask(0)
+, sq_array(nullptr)
+, sq_flags(nullptr)
+, cq_head(nullptr)
+, cq_tail(nullptr)
+, cq_mask(0)
+, cqes(nullptr)
+, sqes(nullptr)
+, buffer_tail(0)
+, next_recv_id(1) // 0 is used for submissions without completion handler
+{
+	if (!setup()) {
+		teardown();
+	}
+}
+
+slirc::network::detail::uring_service::~uring_service() {
+	teardown();
+}
+
+bool slirc::network::detail::uring_service::available() const {
+	return ring_fd != -1;
+}
+
+std::uint64_t slirc::network::detail::uring_service::start_recv(int socket, recv_handler_type handler) {
+	boost::lock_guard<boost::mutex> lock(submit_mutex);
+	const std::uint64_t recv_id = next_recv_id++;
+	receives.emplace(recv_id, std::make_shared<recv_handler_type>(std::move(handler)));
+	if (submit(IORING_OP_RECV, socket, 0, IORING_RECV_MULTISHOT, IOSQE_BUFFER_SELECT, recv_id)) {
+		receives.erase(recv_id);
+		return 0;
+	}
+	return recv_id;
+}
+
+bool slirc::network::detail::uring_service::cancel(std::uint64_t recv_id) {
+	boost::lock_guard<boost::mutex> lock(submit_mutex);
+	if (receives.count(recv_id)) {
+		return !submit(IORING_OP_ASYNC_CANCEL, -1, recv_id, 0, 0, 0);
+	}
+	return true;
+}
+
+void slirc::network::detail::uring_service::release(unsigned buffer) {
+	boost::lock_guard<boost::mutex> lock(submit_mutex);
+	set_buffer(buffer_ring_memory, buffer_tail & (buffer_count - 1),
+		buffers.data() + buffer * buffer_size, buffer_size, buffer);
+	publish_buffers(buffer_ring_memory, ++buffer_tail);
+}
+
+void slirc::network::detail::uring_service::shutdown_service() {
+	boost::system::error_code ignored_error;
+	event_descriptor.close(ignored_error);
+
+	// The handlers keep their connections alive; the receives are not
+	// going to complete anymore. A thread still reaping holds on to the
+	// handler it is calling.
+	boost::lock_guard<boost::mutex> lock(submit_mutex);
+	receives.clear();
+}
+
+bool slirc::network::detail::uring_service::setup() {
+	io_uring_params params;
+	std::memset(&params, 0, sizeof(params));
+	// Multishot receives can produce many completions per submission.
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = completion_entries;
+	ring_fd = io_uring_setup(submission_entries, &params);
+	if (ring_fd < 0) {
+		ring_fd = -1;
+		return false;
+	}
+
+	sq_memory_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_memory_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		sq_memory_size = cq_memory_size = std::max(sq_memory_size, cq_memory_size);
+	}
+	if (!(sq_memory = map_ring(ring_fd, sq_memory_size, IORING_OFF_SQ_RING))) {
+		return false;
+	}
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		cq_memory = sq_memory;
+	}
+	else if (!(cq_memory = map_ring(ring_fd, cq_memory_size, IORING_OFF_CQ_RING))) {
+		return false;
+	}
+	sqe_memory_size = params.sq_entries * sizeof(io_uring_sqe);
+	if (!(sqe_memory = map_ring(ring_fd, sqe_memory_size, IORING_OFF_SQES))) {
+		return false;
+	}
+
+	sq_tail = at<unsigned>(sq_memory, params.sq_off.tail);
+	sq_mask = *at<unsigned>(sq_memory, params.sq_off.ring_mask);
+	sq_array = at<unsigned>(sq_memory, params.sq_off.array);
+	sq_flags = at<unsigned>(sq_memory, params.sq_off.flags);
+	cq_head = at<unsigned>(cq_memory, params.cq_off.head);
+	cq_tail = at<unsigned>(cq_memory, params.cq_off.tail);
+	cq_mask = *at<unsigned>(cq_memory, params.cq_off.ring_mask);
+	cqes = at<void>(cq_memory, params.cq_off.cqes);
+	sqes = sqe_memory;
+	for(unsigned i=0; i<params.sq_entries; ++i) {
+		// submission queue entries are used in order
+		sq_array[i] = i;
+	}
+
+	// the buffers the kernel receives into
+	buffer_ring_size = buffer_count * sizeof(io_uring_buf);
+	if (!(buffer_ring_memory = map_buffer_ring(buffer_ring_size))) {
+		return false;
+	}
+	if (!register_buffer_ring(ring_fd, buffer_ring_memory, buffer_count)) {
+		return false;
+	}
+	buffers.resize(buffer_count * buffer_size);
+	for(unsigned i=0; i<buffer_count; ++i) {
+		set_buffer(buffer_ring_memory, i, buffers.data() + i * buffer_size, buffer_size, i);
+	}
+	buffer_tail = buffer_count;
+	publish_buffers(buffer_ring_memory, buffer_tail);
+
+	if (!probe_multishot_recv()) {
+		return false;
+	}
+
+	// The eventfd integrates the ring into the io_service (and into the
+	// poll_descriptor of applications handling the network manually).
+	event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (event_fd == -1) {
+		return false;
+	}
+	if (io_uring_register(ring_fd, IORING_REGISTER_EVENTFD, &event_fd, 1) != 0) {
+		return false;
+	}
+	boost::system::error_code error;
+	event_descriptor.assign(event_fd, error);
+	if (error) {
+		return false;
+	}
+	poll_descriptor::instance().watch(get_io_service(), event_fd);
+
+	wait_for_completions();
+	return true;
+}
+
+bool slirc::network::detail::uring_service::probe_multishot_recv() {
+	// Older kernels reject the flag. A supported multishot receive takes the
+	// byte sent and ends at the end of the stream.
+	int sockets[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+		return false;
+	}
+	const char probe_byte = 0;
+	bool submitted = write(sockets[1], &probe_byte, 1) == 1;
+	if (submitted) {
+		boost::lock_guard<boost::mutex> lock(submit_mutex);
+		submitted = !submit(IORING_OP_RECV, sockets[0], 0, IORING_RECV_MULTISHOT, IOSQE_BUFFER_SELECT, 0);
+	}
+	::shutdown(sockets[1], SHUT_WR);
+
+	bool result = false;
+	bool finished = !submitted;
+	std::deque<completion> batch;
+	while (!finished) {
+		{ boost::lock_guard<boost::mutex> lock(cq_mutex);
+			collect();
+			batch.swap(pending);
+		}
+		if (batch.empty()) {
+			if (io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+				break;
+			}
+			continue;
+		}
+		for(const completion &c: batch) {
+			if (c.flags & IORING_CQE_F_BUFFER) {
+				release(c.flags >> IORING_CQE_BUFFER_SHIFT);
+			}
+			if (c.result > 0 && (c.flags & IORING_CQE_F_MORE)) {
+				result = true;
+			}
+			if (!(c.flags & IORING_CQE_F_MORE)) {
+				finished = true;
+			}
+		}
+		batch.clear();
+	}
+
+	close(sockets[0]);
+	close(sockets[1]);
+	return result && finished;
+}
+
+void slirc::network::detail::uring_service::teardown() {
+	boost::system::error_code ignored_error;
+	if (event_descriptor.is_open()) {
+		// closes event_fd as well
+		event_descriptor.close(ignored_error);
+		event_fd = -1;
+	}
+	if (event_fd != -1) {
+		close(event_fd);
+		event_fd = -1;
+	}
+	if (ring_fd != -1) {
+		// also releases the buffer ring and cancels all receives
+		close(ring_fd);
+		ring_fd = -1;
+	}
+	if (buffer_ring_memory) {
+		munmap(buffer_ring_memory, buffer_ring_size);
+		buffer_ring_memory = nullptr;
+	}
+	if (sqe_memory) {
+		munmap(sqe_memory, sqe_memory_size);
+		sqe_memory = nullptr;
+	}
+	if (cq_memory && cq_memory != sq_memory) {
+		munmap(cq_memory, cq_memory_size);
+	}
+	cq_memory = nullptr;
+	if (sq_memory) {
+		munmap(sq_memory, sq_memory_size);
+		sq_memory = nullptr;
+	}
+}
+
+int slirc::network::detail::uring_service::submit(unsigned char opcode, int fd, std::uint64_t addr, std::uint16_t ioprio, std::uint8_t flags, std::uint64_t user_data) {
+	// The queue is submitted right away, so there is always room.
+	const unsigned tail = *sq_tail;
+	io_uring_sqe &sqe = static_cast<io_uring_sqe *>(sqes)[tail & sq_mask];
+	std::memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = opcode;
+	sqe.fd = fd;
+	sqe.addr = addr;
+	sqe.ioprio = ioprio;
+	sqe.flags = flags;
+	sqe.buf_group = buffer_group;
+	sqe.user_data = user_data;
+	__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	for(unsigned attempt=1; ; ++attempt) {
+		if (io_uring_enter(ring_fd, 1, 0, 0) >= 0) {
+			return 0;
+		}
+		const int error = errno;
+		if (error == EINTR) {
+			continue;
+		}
+		if ((error != EBUSY && error != EAGAIN) || attempt == submit_attempts) {
+			// Nothing has been consumed, so the entry can be taken back
+			// before the next submission picks it up.
+			__atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+			return error;
+		}
+		// The completion queue is full. Make room without handling the
+		// completions, as reap() might be waiting for submit_mutex.
+		boost::lock_guard<boost::mutex> lock(cq_mutex);
+		collect();
+	}
+}
+
+void slirc::network::detail::uring_service::wait_for_completions() {
+	event_descriptor.async_read_some(
+		boost::asio::buffer(&event_count, sizeof(event_count)),
+		[this](const boost::system::error_code &error, std::size_t) {
+			if (error == boost::asio::error::operation_aborted) {
+				return; // shutting down
+			}
+			reap();
+			wait_for_completions();
+		}
+	);
+}
+
+void slirc::network::detail::uring_service::collect() {
+	for(;;) {
+		unsigned head = *cq_head;
+		const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			if (__atomic_load_n(sq_flags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) {
+				// have the kernel move the completions that did not fit
+				io_uring_enter(ring_fd, 0, 0, IORING_ENTER_GETEVENTS);
+				continue;
+			}
+			return;
+		}
+
+		for(; head != tail; ++head) {
+			const io_uring_cqe &cqe = static_cast<io_uring_cqe *>(cqes)[head & cq_mask];
+			const completion c = { cqe.user_data, cqe.res, cqe.flags };
+			pending.push_back(c);
+		}
+		__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+	}
+}
+
+void slirc::network::detail::uring_service::reap() {
+	std::deque<completion> batch;
+	for(;;) {
+		{ boost::lock_guard<boost::mutex> lock(cq_mutex);
+			collect();
+			batch.swap(pending);
+		}
+		if (batch.empty()) {
+			return;
+		}
+
+		for(const completion &c: batch) {
+			if (!c.recv_id) {
+				continue; // nobody is interested in this one
+			}
+
+			std::shared_ptr<recv_handler_type> handler;
+			{ boost::lock_guard<boost::mutex> lock(submit_mutex);
+				auto it = receives.find(c.recv_id);
+				if (it != receives.end()) {
+					handler = it->second;
+				}
+			}
+			if (!handler) {
+				continue;
+			}
+
+			boost::system::error_code error;
+			if (c.result == -ECANCELED) {
+				error = boost::asio::error::operation_aborted;
+			}
+			else if (c.result < 0) {
+				error = boost::system::error_code(-c.result, boost::system::system_category());
+			}
+			else if (c.result == 0) {
+				error = boost::asio::error::eof;
+			}
+			const unsigned buffer = (c.flags & IORING_CQE_F_BUFFER)
+				? c.flags >> IORING_CQE_BUFFER_SHIFT
+				: no_buffer;
+			const char *data = buffer == no_buffer
+				? nullptr
+				: buffers.data() + buffer * buffer_size;
+			const bool more = c.flags & IORING_CQE_F_MORE;
+
+			(*handler)(error, data, c.result > 0 ? c.result : 0, buffer, more);
+
+			if (!more) {
+				boost::lock_guard<boost::mutex> lock(submit_mutex);
+				receives.erase(c.recv_id);
+			}
+		}
+		batch.clear();
+	}
+}
+
+#endif // LIBSLIRC_OPTION_WITH_IO_URING
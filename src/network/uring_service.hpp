@@ -0,0 +1,186 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_NETWORK_URING_SERVICE_HPP_INCLUDED
+#define LIBSLIRC_HDR_NETWORK_URING_SERVICE_HPP_INCLUDED
+
+#ifdef LIBSLIRC_OPTION_WITH_IO_URING
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace slirc {
+namespace network {
+namespace detail {
+	/**
+	 * \brief Receives from sockets through a Linux io_uring instead of the
+	 *        reactor of the io_service.
+	 *
+	 * Each io_service gets its own ring. Sockets are read by multishot
+	 * receives into a ring of buffers registered with the kernel, so a
+	 * connection needs a single submission for all of its reads, and a
+	 * single wakeup of the io_service can deliver the data of many reads.
+	 *
+	 * Completions are reaped by whichever thread runs the io_service when
+	 * the eventfd of the ring becomes readable.
+	 */
+	struct uring_service: boost::asio::io_service::service {
+		/**
+		 * \brief Handles a completion of a multishot receive.
+		 *
+		 * Called by the thread reaping the completions with:
+		 * - the error, if any (end of file is reported as error::eof)
+		 * - the received data, which is valid until the buffer has been
+		 *   released
+		 * - the buffer to pass to release(), or no_buffer
+		 * - whether more completions of the same receive will follow
+		 */
+		typedef std::function<
+			void(const boost::system::error_code &, const char *, std::size_t, unsigned, bool)
+		> recv_handler_type;
+
+		static const unsigned no_buffer = ~0u;
+
+		static boost::asio::io_service::id id;
+
+		/**
+		 * \brief Checks whether the kernel supports everything needed,
+		 *        i.e. whether a ring can be set up at all.
+		 */
+		static bool supported();
+
+		explicit uring_service(boost::asio::io_service &owner);
+		~uring_service();
+
+		/**
+		 * \brief Checks whether the ring has been set up successfully.
+		 */
+		bool available() const;
+
+		/**
+		 * \brief Starts receiving from a socket until the receive fails or
+		 *        is cancelled.
+		 *
+		 * \return The id of the receive, to be passed to cancel(), or 0 if
+		 *         the receive could not be submitted. In that case, the
+		 *         handler is never called.
+		 */
+		std::uint64_t start_recv(int socket, recv_handler_type handler);
+
+		/**
+		 * \brief Cancels a receive. Its handler is called a last time with
+		 *        error::operation_aborted, unless it has finished already.
+		 *
+		 * \return false if the cancellation could not be submitted, so the
+		 *         receive goes on.
+		 */
+		bool cancel(std::uint64_t recv_id);
+
+		/**
+		 * \brief Gives a buffer back to the kernel to receive into.
+		 */
+		void release(unsigned buffer);
+
+	private:
+		// a completion taken from the completion queue
+		struct completion {
+			std::uint64_t recv_id;
+			int result;
+			unsigned flags;
+		};
+
+		void shutdown_service();
+
+		bool setup();
+		// checks whether the kernel supports multishot receives (Linux 6.0)
+		bool probe_multishot_recv();
+		void teardown();
+		// queues a single submission and submits it; submit_mutex has to be
+		// locked
+		// returns 0 or the errno of the failed submission, which has been
+		// taken back from the queue then
+		int submit(unsigned char opcode, int fd, std::uint64_t addr, std::uint16_t ioprio, std::uint8_t flags, std::uint64_t user_data);
+		// waits for the eventfd to be signalled
+		void wait_for_completions();
+		// moves all completions available into pending, to make room in the
+		// completion queue; cq_mutex has to be locked
+		void collect();
+		// handles all completions available
+		void reap();
+
+		int ring_fd;
+		int event_fd;
+		boost::asio::posix::stream_descriptor event_descriptor;
+		std::uint64_t event_count;
+
+		// the memory shared with the kernel
+		void *sq_memory;
+		std::size_t sq_memory_size;
+		void *cq_memory;
+		std::size_t cq_memory_size;
+		void *sqe_memory;
+		std::size_t sqe_memory_size;
+		void *buffer_ring_memory;
+		std::size_t buffer_ring_size;
+		std::vector<char> buffers;
+
+		// pointers into the memory shared with the kernel
+		unsigned *sq_tail;
+		unsigned sq_mask;
+		unsigned *sq_array;
+		unsigned *sq_flags;
+		unsigned *cq_head;
+		unsigned *cq_tail;
+		unsigned cq_mask;
+		void *cqes;
+		void *sqes;
+
+		// guards the submission queue, the buffer ring and receives
+		// may be locked before cq_mutex, never the other way round
+		boost::mutex submit_mutex;
+			unsigned short buffer_tail;
+			std::uint64_t next_recv_id;
+			// Shared with the reaping thread, which invokes a handler without
+			// holding the mutex.
+			std::map<std::uint64_t, std::shared_ptr<recv_handler_type>> receives;
+
+		// guards the completion queue and pending
+		boost::mutex cq_mutex;
+			// completions collected, but not handled yet
+			std::deque<completion> pending;
+	};
+}
+}
+}
+
+#endif // LIBSLIRC_OPTION_WITH_IO_URING
+
+#endif // LIBSLIRC_HDR_NETWORK_URING_SERVICE_HPP_INCLUDED
@@ -0,0 +1,129 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#include "capture_file.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/interprocess/exceptions.hpp>
+
+#include "../modules/connection.hpp"
+
+namespace {
+	// loads a little endian value from in
+	template <typename T>
+	T load_le(const char *in) {
+		T value = 0;
+		for(std::size_t i=0; i<sizeof(T); ++i) {
+			value |= static_cast<T>(static_cast<unsigned char>(in[i])) << (8 * i);
+		}
+		return value;
+	}
+}
+
+slirc::testing::capture_file::capture_file(const std::string &path) {
+	typedef network::detail::capture_writer writer;
+	try {
+		boost::interprocess::file_mapping mapping(path.c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region mapped(mapping, boost::interprocess::read_only);
+		file.swap(mapping);
+		region.swap(mapped);
+	}
+	catch (const boost::interprocess::interprocess_exception &e) {
+		throw std::runtime_error("Cannot open capture file " + path + ": " + e.what());
+	}
+
+	begin = static_cast<const char *>(region.get_address());
+	end = begin + region.get_size();
+	if (region.get_size() < sizeof(writer::magic) || std::memcmp(begin, writer::magic, sizeof(writer::magic))) {
+		throw std::runtime_error("Not a capture file: " + path);
+	}
+	begin += sizeof(writer::magic);
+	position = begin;
+}
+
+bool slirc::testing::capture_file::next(record &r) {
+	typedef network::detail::capture_writer writer;
+	if (static_cast<std::size_t>(end - position) < writer::record_header_size) {
+		return false;
+	}
+	const std::uint32_t length = load_le<std::uint32_t>(position + 9);
+	if (static_cast<std::size_t>(end - position) - writer::record_header_size < length) {
+		return false;
+	}
+
+	r.time = std::chrono::nanoseconds(load_le<std::uint64_t>(position));
+	r.direction = static_cast<direction_type>(position[8]);
+	r.data = position + writer::record_header_size;
+	r.length = length;
+	position = r.data + length;
+	return true;
+}
+
+void slirc::testing::capture_file::rewind() {
+	position = begin;
+}
+
+std::size_t slirc::testing::capture_file::size() const {
+	return region.get_size();
+}
+
+slirc::testing::replay_stats slirc::testing::replay_capture(capture_file &capture, modules::connection &conn, std::size_t repetitions) {
+	replay_stats stats = replay_stats();
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// an incomplete line and the data following it
+	std::string carry;
+	for(std::size_t i=0; i<repetitions; ++i) {
+		if (i) {
+			capture.rewind();
+		}
+
+		capture_file::record r;
+		while (capture.next(r)) {
+			if (r.direction != capture_file::direction_type::received) {
+				continue;
+			}
+			++stats.records;
+			stats.bytes += r.length;
+
+			if (carry.empty()) {
+				// the common case: straight from the mapped file
+				const std::size_t consumed = conn.inject(r.data, r.length);
+				carry.assign(r.data + consumed, r.length - consumed);
+			}
+			else {
+				carry.append(r.data, r.length);
+				carry.erase(0, conn.inject(carry.data(), carry.size()));
+			}
+		}
+		// never glue the end of the capture to its start
+		carry.clear();
+		conn.end_inject();
+	}
+
+	stats.elapsed = std::chrono::steady_clock::now() - start;
+	return stats;
+}
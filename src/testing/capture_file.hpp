@@ -0,0 +1,129 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_TESTING_CAPTURE_FILE_HPP_INCLUDED
+#define LIBSLIRC_HDR_TESTING_CAPTURE_FILE_HPP_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "../network/capture_writer.hpp"
+
+namespace slirc {
+namespace modules {
+	struct connection;
+}
+
+namespace testing {
+
+/**
+ * \brief Reads a file written by network::connection::start_capture().
+ *
+ * The file is mapped into memory, so the data of the records is never
+ * copied.
+ */
+struct capture_file: private boost::noncopyable {
+	/// \brief The direction of a record.
+	typedef network::detail::capture_writer::direction_type direction_type;
+
+	/**
+	 * \brief A record of the capture.
+	 */
+	struct record {
+		std::chrono::nanoseconds time; ///< \brief The time since the capture was started.
+		direction_type direction; ///< \brief Whether the data was sent or received.
+		const char *data; ///< \brief The data, valid as long as the capture_file exists.
+		std::size_t length; ///< \brief The number of bytes available at data.
+	};
+
+	/**
+	 * \brief Opens a capture file.
+	 *
+	 * \throw std::runtime_error if the file cannot be opened or is no
+	 *        capture file.
+	 */
+	explicit capture_file(const std::string &path);
+
+	/**
+	 * \brief Reads the next record.
+	 *
+	 * \param r Receives the record.
+	 *
+	 * \return false if there are no more records. A record cut short, e.g.
+	 *         by a crash while capturing, ends the file.
+	 */
+	bool next(record &r);
+
+	/**
+	 * \brief Starts reading at the first record again.
+	 */
+	void rewind();
+
+	/**
+	 * \brief Returns the size of the file in bytes.
+	 */
+	std::size_t size() const;
+
+private:
+	boost::interprocess::file_mapping file;
+	boost::interprocess::mapped_region region;
+	const char *begin;
+	const char *end;
+	const char *position;
+};
+
+/**
+ * \brief Statistics of replay_capture().
+ */
+struct replay_stats {
+	std::size_t records; ///< \brief The number of records replayed.
+	std::size_t bytes; ///< \brief The number of bytes replayed.
+	std::chrono::steady_clock::duration elapsed; ///< \brief The time it took.
+};
+
+/**
+ * \brief Feeds the received data of a capture into a connection as fast as
+ *        possible.
+ *
+ * The data is passed to modules::connection::inject(), so every line
+ * results in a raw_irc_line_event just like it did when it was captured,
+ * but without any network involved. Sent data is skipped. The connection
+ * has to be disconnected.
+ *
+ * \param capture The capture to replay, from its current position.
+ * \param conn The connection to feed.
+ * \param repetitions How often to replay the capture. Each repetition
+ *                    rewinds the capture and starts with a fresh line.
+ *
+ * \throw std::logic_error if the connection is not disconnected.
+ */
+replay_stats replay_capture(capture_file &capture, modules::connection &conn, std::size_t repetitions = 1);
+
+}
+}
+
+#endif // LIBSLIRC_HDR_TESTING_CAPTURE_FILE_HPP_INCLUDED
@@ -0,0 +1,451 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#include "fake_server.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <map>
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "../helper/shared_buffer.hpp"
+#include "../network/connection.hpp"
+#include "../network/listener.hpp"
+
+namespace {
+	// the most lines kept for take_received()
+	const std::size_t max_kept_lines = 65536;
+	// the most lines sent at once when sending as fast as possible
+	const std::size_t max_batch_lines = 1024;
+	// clients with more data waiting to be sent are not sent any more
+	const std::size_t max_client_backlog = 1024 * 1024;
+
+	// returns the upper case command of a line and the position after it
+	std::string command_of(const std::string &line, std::string::size_type &end) {
+		std::string::size_type begin = line.find_first_not_of(' ');
+		if (begin != line.npos && line[begin] == ':') {
+			// skip the prefix
+			begin = line.find(' ', begin);
+			begin = begin == line.npos ? begin : line.find_first_not_of(' ', begin);
+		}
+		if (begin == line.npos) {
+			end = line.size();
+			return std::string();
+		}
+		end = std::min(line.find(' ', begin), line.size());
+		std::string command = line.substr(begin, end - begin);
+		for(char &c: command) {
+			c = std::toupper(static_cast<unsigned char>(c));
+		}
+		return command;
+	}
+
+	// returns the first parameter of a line, starting at pos
+	std::string first_parameter(const std::string &line, std::string::size_type pos) {
+		pos = line.find_first_not_of(' ', pos);
+		if (pos == line.npos) {
+			return std::string();
+		}
+		if (line[pos] == ':') {
+			return line.substr(pos + 1);
+		}
+		return line.substr(pos, line.find(' ', pos) - pos);
+	}
+
+	std::string replace_nick(std::string line, const std::string &nick) {
+		static const std::string placeholder("$nick");
+		for(
+			std::string::size_type pos = line.find(placeholder);
+			pos != line.npos;
+			pos = line.find(placeholder, pos + nick.size())
+		) {
+			line.replace(pos, placeholder.size(), nick);
+		}
+		return line;
+	}
+}
+
+namespace slirc {
+namespace testing {
+namespace detail {
+	struct fake_server_implementation: std::enable_shared_from_this<fake_server_implementation> {
+		typedef fake_server::command_handler_type command_handler_type;
+		typedef fake_server::generator_type generator_type;
+
+		struct client_state: fake_server::client {
+			client_state(std::shared_ptr<network::connection> conn)
+			: conn(std::move(conn))
+			{}
+
+			void send(const std::string &line) override {
+				conn->send(line + "\r\n");
+			}
+
+			void disconnect() override {
+				conn->disconnect();
+			}
+
+			std::string nick() const override {
+				boost::lock_guard<boost::mutex> lock(mutex);
+				return registered_nick;
+			}
+
+			std::shared_ptr<network::connection> conn;
+			mutable boost::mutex mutex;
+				std::string registered_nick;
+		};
+
+		// traffic to be sent to all clients
+		struct feed {
+			generator_type generator;
+			std::size_t count; // number of lines to send
+			std::size_t next; // index of the next line to send
+			double rate; // lines per second, 0 for as fast as possible
+			std::chrono::steady_clock::time_point start;
+		};
+
+		fake_server_implementation(boost::asio::io_service &service)
+		: io(service)
+		, listener(service, 1)
+		, timer(service)
+		, timer_pending(false)
+		, received_count(0)
+		, sent_count(0)
+		{
+			// the defaults needed to get a client registered
+			respond("USER", { ":fake.server 001 $nick :Welcome to the fake IRC server, $nick" });
+			handlers["PING"] = [](fake_server::client &c, const std::string &line) {
+				std::string::size_type end;
+				command_of(line, end);
+				c.send(":fake.server PONG fake.server :" + first_parameter(line, end));
+			};
+		}
+
+		void listen() {
+			std::weak_ptr<fake_server_implementation> weak_self = shared_from_this();
+			listener.on_accept([weak_self](std::shared_ptr<network::connection> conn) {
+				if (auto self = weak_self.lock()) {
+					self->accepted(conn);
+				}
+			});
+			listener.listen("127.0.0.1", 0);
+		}
+
+		void close() {
+			listener.close();
+
+			boost::lock_guard<boost::mutex> lock(mutex);
+			for(std::shared_ptr<client_state> &c: clients) {
+				c->disconnect();
+			}
+			clients.clear();
+			feeds.clear();
+			boost::system::error_code ignored_error;
+			timer.cancel(ignored_error);
+		}
+
+		void respond(const std::string &command, const std::vector<std::string> &replies) {
+			on_command(command, [replies](fake_server::client &c, const std::string &) {
+				const std::string nick = c.nick();
+				for(const std::string &reply: replies) {
+					c.send(replace_nick(reply, nick));
+				}
+			});
+		}
+
+		void on_command(std::string command, command_handler_type handler) {
+			for(char &c: command) {
+				c = std::toupper(static_cast<unsigned char>(c));
+			}
+			boost::lock_guard<boost::mutex> lock(mutex);
+			handlers[command] = handler;
+		}
+
+		void send_all(const std::string &line) {
+			const helper::shared_buffer data = helper::make_shared_buffer(line + "\r\n");
+			boost::lock_guard<boost::mutex> lock(mutex);
+			for(std::shared_ptr<client_state> &c: clients) {
+				c->conn->send(data);
+			}
+			sent_count += clients.size();
+		}
+
+		void add_feed(generator_type generator, std::size_t count, double rate) {
+			boost::lock_guard<boost::mutex> lock(mutex);
+			feed f = { generator, count, 0, rate, std::chrono::steady_clock::now() };
+			feeds.push_back(f);
+			if (!timer_pending) {
+				timer_pending = true;
+				std::weak_ptr<fake_server_implementation> weak_self = shared_from_this();
+				io.post([weak_self]() {
+					if (auto self = weak_self.lock()) {
+						self->pump();
+					}
+				});
+			}
+		}
+
+		boost::asio::io_service &io;
+		network::listener listener;
+		boost::asio::steady_timer timer;
+		mutable boost::mutex mutex;
+			std::vector<std::shared_ptr<client_state>> clients;
+			std::map<std::string, command_handler_type> handlers;
+			std::deque<feed> feeds;
+			bool timer_pending; // pump() has been posted or scheduled
+			std::vector<std::string> received;
+			std::size_t received_count;
+			std::size_t sent_count;
+
+	private:
+		void accepted(std::shared_ptr<network::connection> conn) {
+			std::shared_ptr<client_state> c = std::make_shared<client_state>(conn);
+			std::weak_ptr<fake_server_implementation> weak_self = shared_from_this();
+			std::weak_ptr<client_state> weak_client = c;
+
+			conn->on_recv_view([weak_self, weak_client](const char *data, std::size_t length) {
+				auto self = weak_self.lock();
+				auto c = weak_client.lock();
+				if (!self || !c) {
+					return length;
+				}
+
+				// frames lines ending in LF, with or without CR
+				const char *begin = data;
+				const char *const end = data + length;
+				const char *eol;
+				while (end != (eol = std::find(begin, end, '\n'))) {
+					const char *line_end = (eol != begin && eol[-1] == '\r') ? eol - 1 : eol;
+					if (line_end != begin) {
+						self->handle_line(*c, std::string(begin, line_end));
+					}
+					begin = eol + 1;
+				}
+				return static_cast<std::size_t>(begin - data);
+			});
+			conn->on_status([weak_self, weak_client](const boost::system::error_code &error) {
+				auto self = weak_self.lock();
+				auto c = weak_client.lock();
+				if (error && self && c) {
+					boost::lock_guard<boost::mutex> lock(self->mutex);
+					self->clients.erase(
+						std::remove(self->clients.begin(), self->clients.end(), c),
+						self->clients.end());
+				}
+			});
+
+			boost::lock_guard<boost::mutex> lock(mutex);
+			clients.push_back(c);
+		}
+
+		void handle_line(client_state &c, const std::string &line) {
+			std::string::size_type end;
+			const std::string command = command_of(line, end);
+			if (command == "NICK") {
+				boost::lock_guard<boost::mutex> lock(c.mutex);
+				c.registered_nick = first_parameter(line, end);
+			}
+
+			command_handler_type handler;
+			{ boost::lock_guard<boost::mutex> lock(mutex);
+				++received_count;
+				if (received.size() < max_kept_lines) {
+					received.push_back(line);
+				}
+				auto it = handlers.find(command);
+				if (it == handlers.end()) {
+					it = handlers.find("*");
+				}
+				if (it != handlers.end()) {
+					handler = it->second;
+				}
+			}
+			if (handler) {
+				handler(c, line);
+			}
+		}
+
+		// sends the lines of the current feed that are due and schedules the
+		// next call
+		void pump() {
+			boost::lock_guard<boost::mutex> lock(mutex);
+			if (feeds.empty()) {
+				timer_pending = false;
+				return;
+			}
+
+			feed &f = feeds.front();
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			const double elapsed = std::chrono::duration<double>(now - f.start).count();
+
+			bool congested = false;
+			for(std::shared_ptr<client_state> &c: clients) {
+				congested = congested || c->conn->send_queue_size() > max_client_backlog;
+			}
+
+			std::size_t due = f.next;
+			if (f.rate > 0) {
+				due = std::min(f.count, static_cast<std::size_t>(elapsed * f.rate) + 1);
+			}
+			else if (!congested) {
+				due = std::min(f.count, f.next + max_batch_lines);
+			}
+
+			if (due > f.next) {
+				sent_count += (due - f.next) * clients.size();
+				std::string chunk;
+				for(; f.next < due; ++f.next) {
+					chunk += f.generator(f.next);
+					chunk += "\r\n";
+				}
+				const helper::shared_buffer data = helper::make_shared_buffer(std::move(chunk));
+				for(std::shared_ptr<client_state> &c: clients) {
+					c->conn->send(data);
+				}
+			}
+
+			if (f.next == f.count) {
+				feeds.pop_front();
+				if (!feeds.empty()) {
+					feeds.front().start = now;
+				}
+			}
+
+			if (feeds.empty()) {
+				timer_pending = false;
+				return;
+			}
+
+			// wait for the next line to be due or for the clients to catch up
+			std::chrono::steady_clock::duration delay = std::chrono::milliseconds(1);
+			if (feeds.front().rate > 0) {
+				const feed &next = feeds.front();
+				const std::chrono::duration<double> next_due(next.next / next.rate);
+				delay = std::max(
+					std::chrono::duration_cast<std::chrono::steady_clock::duration>(next_due - (now - next.start)),
+					std::chrono::steady_clock::duration::zero());
+			}
+			else if (!congested) {
+				delay = std::chrono::steady_clock::duration::zero();
+			}
+
+			std::weak_ptr<fake_server_implementation> weak_self = shared_from_this();
+			timer.expires_from_now(delay);
+			timer.async_wait([weak_self](const boost::system::error_code &error) {
+				auto self = weak_self.lock();
+				if (!error && self) {
+					self->pump();
+				}
+			});
+		}
+	};
+}
+}
+}
+
+slirc::testing::fake_server::fake_server()
+: impl(std::make_shared<detail::fake_server_implementation>(network::service)) {}
+
+slirc::testing::fake_server::fake_server(boost::asio::io_service &service)
+: impl(std::make_shared<detail::fake_server_implementation>(service)) {}
+
+slirc::testing::fake_server::~fake_server() {
+	impl->close();
+}
+
+void slirc::testing::fake_server::listen() {
+	impl->listen();
+}
+
+unsigned slirc::testing::fake_server::port() const {
+	return impl->listener.port();
+}
+
+std::string slirc::testing::fake_server::hostport() const {
+	return "127.0.0.1:" + std::to_string(port());
+}
+
+void slirc::testing::fake_server::respond(const std::string &command, const std::vector<std::string> &replies) {
+	impl->respond(command, replies);
+}
+
+void slirc::testing::fake_server::on_command(const std::string &command, command_handler_type handler) {
+	impl->on_command(command, handler);
+}
+
+void slirc::testing::fake_server::send_all(const std::string &line) {
+	impl->send_all(line);
+}
+
+void slirc::testing::fake_server::replay(const std::vector<std::string> &lines, double lines_per_second, std::size_t repetitions) {
+	if (lines.empty()) {
+		return;
+	}
+	std::shared_ptr<const std::vector<std::string>> recording =
+		std::make_shared<const std::vector<std::string>>(lines);
+	impl->add_feed([recording](std::size_t n) {
+		return (*recording)[n % recording->size()];
+	}, lines.size() * repetitions, lines_per_second);
+}
+
+void slirc::testing::fake_server::synthesize(generator_type generator, std::size_t count, double lines_per_second) {
+	impl->add_feed(generator, count, lines_per_second);
+}
+
+bool slirc::testing::fake_server::sending() const {
+	boost::lock_guard<boost::mutex> lock(impl->mutex);
+	return !impl->feeds.empty();
+}
+
+void slirc::testing::fake_server::stop_sending() {
+	boost::lock_guard<boost::mutex> lock(impl->mutex);
+	impl->feeds.clear();
+}
+
+std::size_t slirc::testing::fake_server::clients() const {
+	boost::lock_guard<boost::mutex> lock(impl->mutex);
+	return impl->clients.size();
+}
+
+std::size_t slirc::testing::fake_server::received_lines() const {
+	boost::lock_guard<boost::mutex> lock(impl->mutex);
+	return impl->received_count;
+}
+
+std::vector<std::string> slirc::testing::fake_server::take_received() {
+	std::vector<std::string> result;
+	boost::lock_guard<boost::mutex> lock(impl->mutex);
+	result.swap(impl->received);
+	return result;
+}
+
+std::size_t slirc::testing::fake_server::sent_lines() const {
+	boost::lock_guard<boost::mutex> lock(impl->mutex);
+	return impl->sent_count;
+}
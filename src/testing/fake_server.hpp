@@ -0,0 +1,230 @@
+/***************************************************************************
+**  Copyright 2014-2014 by Simon "SlashLife" Stienen                      **
+**  http://projects.slashlife.org/libslirc/                               **
+**  libslirc@projects.slashlife.org                                       **
+**                                                                        **
+**  This file is part of libslIRC.                                        **
+**                                                                        **
+**  libslIRC is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  libslIRC is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  and the GNU Lesser General Public License along with libslIRC.        **
+**  If not, see <http://www.gnu.org/licenses/>.                           **
+***************************************************************************/
+
+#ifndef LIBSLIRC_HDR_TESTING_FAKE_SERVER_HPP_INCLUDED
+#define LIBSLIRC_HDR_TESTING_FAKE_SERVER_HPP_INCLUDED
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "../network.hpp"
+
+namespace slirc {
+namespace testing {
+
+namespace detail {
+	struct fake_server_implementation;
+}
+
+/**
+ * \brief A scriptable IRC server running in the same process.
+ *
+ * The server listens on a random port of the loopback interface, so
+ * modules::connection (or a plain network::connection) can connect to it
+ * like to any other server, e.g. using hostport().
+ *
+ * Lines received from clients are answered according to the replies set up
+ * by respond() and on_command(). Traffic can be sent to all clients by
+ * send_all(), replayed from a recording by replay() or generated by
+ * synthesize(), either as fast as possible or at a fixed rate.
+ *
+ * \note All functions are thread safe. Handlers are called by the threads
+ *       running the io_service of the server.
+ */
+struct fake_server: private boost::noncopyable {
+	/**
+	 * \brief A client connected to the server.
+	 */
+	struct client {
+		virtual ~client() {}
+
+		/**
+		 * \brief Sends a line to the client.
+		 *
+		 * \param line The line to send, without line ending.
+		 */
+		virtual void send(const std::string &line) = 0;
+
+		/**
+		 * \brief Disconnects the client.
+		 */
+		virtual void disconnect() = 0;
+
+		/**
+		 * \brief Returns the nick name the client has registered, if any.
+		 */
+		virtual std::string nick() const = 0;
+	};
+
+	/**
+	 * \brief Callback type for command handlers.
+	 *
+	 * Called with the client that sent the line and the line itself.
+	 */
+	typedef std::function<
+		void(client &, const std::string &)
+	> command_handler_type;
+
+	/**
+	 * \brief Generates the n-th line of synthesized traffic.
+	 */
+	typedef std::function<
+		std::string(std::size_t)
+	> generator_type;
+
+	/**
+	 * \brief Constructs a server running on libslirc's own io_service.
+	 *
+	 * It answers PING with PONG and registrations (NICK and USER) with
+	 * RPL_WELCOME (001). Call listen() to start accepting clients.
+	 */
+	fake_server();
+
+	/**
+	 * \brief Constructs a server running on the given io_service.
+	 *
+	 * \param service The io_service to run the server on. It has to outlive
+	 *                the server.
+	 */
+	explicit fake_server(boost::asio::io_service &service);
+
+	/**
+	 * \brief Disconnects all clients and stops listening.
+	 */
+	~fake_server();
+
+	/**
+	 * \brief Starts accepting clients on a random port of 127.0.0.1.
+	 *
+	 * \throw boost::system::system_error if listening fails.
+	 */
+	void listen();
+
+	/**
+	 * \brief Returns the port the server listens on.
+	 */
+	unsigned port() const;
+
+	/**
+	 * \brief Returns the connection string for modules::connection.
+	 */
+	std::string hostport() const;
+
+	/**
+	 * \brief Sets up fixed replies to a command.
+	 *
+	 * Every occurrence of "$nick" in the replies is replaced by the nick name
+	 * of the client.
+	 *
+	 * \param command The command to reply to, e.g. "JOIN". Case insensitive.
+	 * \param replies The lines to send, without line endings. Replaces
+	 *                earlier replies and handlers for the same command; no
+	 *                replies at all ignore the command.
+	 */
+	void respond(const std::string &command, const std::vector<std::string> &replies);
+
+	/**
+	 * \brief Sets up a handler for a command.
+	 *
+	 * \param command The command to handle, e.g. "PRIVMSG", or "*" for all
+	 *                commands without a reply or handler of their own.
+	 * \param handler The handler to call for every line with that command.
+	 */
+	void on_command(const std::string &command, command_handler_type handler);
+
+	/**
+	 * \brief Sends a line to all connected clients.
+	 *
+	 * \param line The line to send, without line ending.
+	 */
+	void send_all(const std::string &line);
+
+	/**
+	 * \brief Sends recorded traffic to all connected clients.
+	 *
+	 * Replayed and synthesized traffic is sent in the order it has been set
+	 * up. Clients falling behind by more than 1 MiB are waited for.
+	 *
+	 * \param lines The lines to send, without line endings.
+	 * \param lines_per_second The rate to send the lines at, or 0 to send
+	 *                         them as fast as the clients take them.
+	 * \param repetitions How often to send all lines.
+	 */
+	void replay(const std::vector<std::string> &lines, double lines_per_second = 0, std::size_t repetitions = 1);
+
+	/**
+	 * \brief Sends generated traffic to all connected clients.
+	 *
+	 * \param generator Generates each line, without line ending. Must not
+	 *                  call the server.
+	 * \param count The number of lines to generate.
+	 * \param lines_per_second The rate to send the lines at, or 0 to send
+	 *                         them as fast as the clients take them.
+	 */
+	void synthesize(generator_type generator, std::size_t count, double lines_per_second = 0);
+
+	/**
+	 * \brief Checks whether replayed or synthesized traffic is still being
+	 *        sent.
+	 */
+	bool sending() const;
+
+	/**
+	 * \brief Stops all replayed and synthesized traffic.
+	 */
+	void stop_sending();
+
+	/**
+	 * \brief Returns the number of clients currently connected.
+	 */
+	std::size_t clients() const;
+
+	/**
+	 * \brief Returns the number of lines received from all clients so far.
+	 */
+	std::size_t received_lines() const;
+
+	/**
+	 * \brief Returns the lines received so far and forgets them.
+	 *
+	 * At most 65536 lines are kept; all further lines are only counted.
+	 */
+	std::vector<std::string> take_received();
+
+	/**
+	 * \brief Returns the number of lines sent to all clients so far.
+	 */
+	std::size_t sent_lines() const;
+
+private:
+	std::shared_ptr<detail::fake_server_implementation> impl;
+};
+
+}
+}
+
+#endif // LIBSLIRC_HDR_TESTING_FAKE_SERVER_HPP_INCLUDED